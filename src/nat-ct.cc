@@ -0,0 +1,255 @@
+/*
+ * nat-ct.cc
+ *
+ * constant time natural numbers for secret operands
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdexcept>
+
+#include "nat-ct.h"
+
+using limb_t = Nat::limb_t;
+using limb2_t = Nat::limb2_t;
+
+
+/*------------------------------.
+| constant time natural number. |
+`------------------------------*/
+
+/*! limb counts are public, so checking them may branch */
+static void _check(size_t an, size_t bn)
+{
+	if (an != bn) {
+		throw std::invalid_argument("ConstTimeNat limb counts differ");
+	}
+}
+
+/*! zero of n limbs */
+ConstTimeNat::ConstTimeNat(size_t n)
+{
+	limbs.resize(n);
+}
+
+/*! value truncated or zero extended to n limbs */
+ConstTimeNat::ConstTimeNat(const Nat &v, size_t n)
+{
+	limbs.resize(n);
+	size_t vn = std::min(v.num_limbs(), n);
+	std::copy(v.limbs.data(), v.limbs.data() + vn, limbs.data());
+}
+
+/*! convert to Nat */
+Nat ConstTimeNat::to_nat() const
+{
+	Nat r;
+	r.limbs.assign(limbs.data(), limbs.size());
+	r._contract();
+	return r;
+}
+
+/*! add returning carry */
+limb_t ConstTimeNat::add(ConstTimeNat &r, const ConstTimeNat &a, const ConstTimeNat &b)
+{
+	size_t n = a.num_limbs();
+	_check(n, b.num_limbs());
+	r.limbs.resize(n);
+	return _add_n(r.limbs.data(), a.limbs.data(), b.limbs.data(), n);
+}
+
+/*! subtract returning borrow */
+limb_t ConstTimeNat::sub(ConstTimeNat &r, const ConstTimeNat &a, const ConstTimeNat &b)
+{
+	size_t n = a.num_limbs();
+	_check(n, b.num_limbs());
+	r.limbs.resize(n);
+	return _sub_n(r.limbs.data(), a.limbs.data(), b.limbs.data(), n);
+}
+
+/*! compare */
+int ConstTimeNat::cmp(const ConstTimeNat &a, const ConstTimeNat &b)
+{
+	_check(a.num_limbs(), b.num_limbs());
+	return _cmp(a.limbs.data(), b.limbs.data(), a.num_limbs());
+}
+
+/*! select */
+void ConstTimeNat::select(ConstTimeNat &r, limb_t cond, const ConstTimeNat &a, const ConstTimeNat &b)
+{
+	size_t n = a.num_limbs();
+	_check(n, b.num_limbs());
+	r.limbs.resize(n);
+	_select(r.limbs.data(), _mask(cond), a.limbs.data(), b.limbs.data(), n);
+}
+
+/*! conditional swap */
+void ConstTimeNat::cswap(limb_t cond, ConstTimeNat &a, ConstTimeNat &b)
+{
+	_check(a.num_limbs(), b.num_limbs());
+	_cswap(_mask(cond), a.limbs.data(), b.limbs.data(), a.num_limbs());
+}
+
+
+/*-----------------------.
+| constant time kernels. |
+`-----------------------*/
+
+/*!
+ * mask from a condition bit. the empty asm hides the value so the compiler
+ * cannot prove it is all zeros or all ones and turn its uses into branches.
+ */
+limb_t ConstTimeNat::_mask(limb_t bit)
+{
+	limb_t m = limb_t(0) - (bit & 1);
+#if defined(__GNUC__)
+	__asm__("" : "+r"(m));
+#endif
+	return m;
+}
+
+/*! add n limbs returning carry, the carry is taken from the double width sum */
+limb_t ConstTimeNat::_add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb2_t t = limb2_t(a[i]) + b[i] + carry;
+		r[i] = limb_t(t);
+		carry = limb_t(t >> Nat::limb_bits);
+	}
+	return carry;
+}
+
+/*! subtract n limbs returning borrow, the borrow is the wrapped high half */
+limb_t ConstTimeNat::_sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+	limb_t borrow = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb2_t t = limb2_t(a[i]) - b[i] - borrow;
+		r[i] = limb_t(t);
+		borrow = limb_t(t >> Nat::limb_bits) & 1;
+	}
+	return borrow;
+}
+
+/*! compare by the borrows of a - b and b - a over every limb */
+int ConstTimeNat::_cmp(const limb_t *a, const limb_t *b, size_t n)
+{
+	limb_t lt = 0, gt = 0;
+	for (size_t i = 0; i < n; i++) {
+		lt = limb_t((limb2_t(a[i]) - b[i] - lt) >> Nat::limb_bits) & 1;
+		gt = limb_t((limb2_t(b[i]) - a[i] - gt) >> Nat::limb_bits) & 1;
+	}
+	return int(gt) - int(lt);
+}
+
+/*! masked select */
+void ConstTimeNat::_select(limb_t *r, limb_t mask, const limb_t *a, const limb_t *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		r[i] = (a[i] & mask) | (b[i] & ~mask);
+	}
+}
+
+/*! masked swap */
+void ConstTimeNat::_cswap(limb_t mask, limb_t *a, limb_t *b, size_t n)
+{
+	for (size_t i = 0; i < n; i++) {
+		limb_t x = (a[i] ^ b[i]) & mask;
+		a[i] ^= x;
+		b[i] ^= x;
+	}
+}
+
+/*!
+ * coarsely integrated operand scanning as in MontgomeryContext, which is
+ * branch free apart from the final subtraction. here t - m is always
+ * computed and the result selected by mask from t[n] and the borrow.
+ */
+void ConstTimeNat::_mont_mul(limb_t *r, const limb_t *a, const limb_t *b,
+	const MontgomeryContext &ctx, limb_t *t)
+{
+	size_t n = ctx.n;
+	const limb_t *mp = ctx.m.limbs.data();
+	limb_t minv = ctx.minv, *u = t + n + 2;
+	std::fill(t, t + n + 2, limb_t(0));
+	for (size_t i = 0; i < n; i++) {
+		limb_t c = Nat::_addmul_1(t, a, n, b[i]);
+		limb2_t s = limb2_t(t[n]) + c;
+		t[n] = limb_t(s);
+		t[n + 1] = limb_t(s >> Nat::limb_bits);
+
+		limb_t q = t[0] * minv;
+		limb2_t p = limb2_t(q) * mp[0] + t[0];
+		c = limb_t(p >> Nat::limb_bits);
+		for (size_t j = 1; j < n; j++) {
+			p = limb2_t(q) * mp[j] + t[j] + c;
+			t[j - 1] = limb_t(p);
+			c = limb_t(p >> Nat::limb_bits);
+		}
+		s = limb2_t(t[n]) + c;
+		t[n - 1] = limb_t(s);
+		t[n] = t[n + 1] + limb_t(s >> Nat::limb_bits);
+	}
+	limb_t borrow = _sub_n(u, t, mp, n);
+	_select(r, _mask(borrow & (t[n] ^ 1)), t, u, n);
+}
+
+
+/*------------------------------.
+| constant time exponentiation. |
+`------------------------------*/
+
+/*!
+ * Montgomery ladder keeping r1 = r0 * base. for each exponent bit the pair
+ * is swapped when the bit differs from the previous one, then r1 = r0 * r1
+ * and r0 = r0^2, so the sequence of operations is the same for every
+ * exponent of the same limb count.
+ */
+ConstTimeNat modpow(const ConstTimeNat &base, const ConstTimeNat &exp, const MontgomeryContext &ctx)
+{
+	size_t n = ctx.n;
+	_check(base.num_limbs(), n);
+
+	Nat::limb_vector buf;
+	buf.resize(4 * n + ConstTimeNat::_mont_scratch(n));
+	limb_t *r0 = buf.data(), *r1 = r0 + n, *one = r1 + n, *r2 = one + n, *t = r2 + n;
+	one[0] = 1;
+	std::copy(ctx.r2.limbs.data(), ctx.r2.limbs.data() + ctx.r2.num_limbs(), r2);
+
+	ConstTimeNat::_mont_mul(r0, one, r2, ctx, t);
+	ConstTimeNat::_mont_mul(r1, base.limbs.data(), r2, ctx, t);
+
+	const limb_t *e = exp.limbs.data();
+	limb_t prev = 0;
+	for (size_t i = exp.num_limbs() * Nat::limb_bits; i-- > 0; ) {
+		limb_t bit = (e[i / Nat::limb_bits] >> (i % Nat::limb_bits)) & 1;
+		ConstTimeNat::_cswap(ConstTimeNat::_mask(bit ^ prev), r0, r1, n);
+		prev = bit;
+		ConstTimeNat::_mont_mul(r1, r0, r1, ctx, t);
+		ConstTimeNat::_mont_mul(r0, r0, r0, ctx, t);
+	}
+	ConstTimeNat::_cswap(ConstTimeNat::_mask(prev), r0, r1, n);
+
+	ConstTimeNat r(n);
+	ConstTimeNat::_mont_mul(r.limbs.data(), r0, one, ctx, t);
+	return r;
+}
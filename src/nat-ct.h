@@ -0,0 +1,157 @@
+/*
+ * nat-ct.h
+ *
+ * constant time natural numbers for secret operands
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "nat-mod.h"
+
+/*
+ * ConstTimeNat holds a fixed number of limbs that is never contracted,
+ * so its storage reveals only the width chosen by the caller. for values
+ * of equal limb count the kernels execute the same instructions and
+ * memory accesses: carries are propagated arithmetically, comparisons
+ * scan every limb and conditions are applied as all ones or all zeros
+ * limb masks rather than branches.
+ *
+ * limb counts are treated as public and mismatched counts throw
+ * std::invalid_argument. conversion to and from Nat is variable time
+ * and the modulus of a MontgomeryContext is treated as public.
+ */
+
+
+/*------------------------------.
+| constant time natural number. |
+`------------------------------*/
+
+struct ConstTimeNat
+{
+	typedef Nat::limb_t limb_t;
+	typedef Nat::limb2_t limb2_t;
+
+	/* limbs holds exactly num_limbs() words with the little end at offset 0 */
+	Nat::limb_vector limbs;
+
+
+	/*--------------.
+	| constructors. |
+	`--------------*/
+
+	/*! zero of n limbs */
+	explicit ConstTimeNat(size_t n);
+
+	/*! value truncated or zero extended to n limbs */
+	ConstTimeNat(const Nat &v, size_t n);
+
+	/*! number of limbs */
+	size_t num_limbs() const { return limbs.size(); }
+
+	/*! convert to Nat */
+	Nat to_nat() const;
+
+
+	/*-----------------------.
+	| arithmetic operations. |
+	`-----------------------*/
+
+	/*! r = a + b modulo 2^(limb_bits * n) returning the carry out */
+	static limb_t add(ConstTimeNat &r, const ConstTimeNat &a, const ConstTimeNat &b);
+
+	/*! r = a - b modulo 2^(limb_bits * n) returning the borrow out */
+	static limb_t sub(ConstTimeNat &r, const ConstTimeNat &a, const ConstTimeNat &b);
+
+	/*! -1, 0 or 1 as a is less than, equal to or greater than b */
+	static int cmp(const ConstTimeNat &a, const ConstTimeNat &b);
+
+	/*! r = cond ? a : b for cond of 0 or 1 */
+	static void select(ConstTimeNat &r, limb_t cond, const ConstTimeNat &a, const ConstTimeNat &b);
+
+	/*! swap a and b if cond is 1, leave them if cond is 0 */
+	static void cswap(limb_t cond, ConstTimeNat &a, ConstTimeNat &b);
+
+	/*! add equals, wrapping */
+	ConstTimeNat& operator+=(const ConstTimeNat &operand) { add(*this, *this, operand); return *this; }
+
+	/*! subtract equals, wrapping */
+	ConstTimeNat& operator-=(const ConstTimeNat &operand) { sub(*this, *this, operand); return *this; }
+
+	/*! add, wrapping */
+	ConstTimeNat operator+(const ConstTimeNat &operand) const { ConstTimeNat r(*this); return r += operand; }
+
+	/*! subtract, wrapping */
+	ConstTimeNat operator-(const ConstTimeNat &operand) const { ConstTimeNat r(*this); return r -= operand; }
+
+	/*! equals */
+	bool operator==(const ConstTimeNat &operand) const { return cmp(*this, operand) == 0; }
+
+	/*! not equals */
+	bool operator!=(const ConstTimeNat &operand) const { return cmp(*this, operand) != 0; }
+
+	/*! less than */
+	bool operator<(const ConstTimeNat &operand) const { return cmp(*this, operand) < 0; }
+
+
+	/*-----------------------.
+	| constant time kernels. |
+	`-----------------------*/
+
+	/*! all ones if bit is 1, all zeros if bit is 0, opaque to the optimizer */
+	static limb_t _mask(limb_t bit);
+
+	/*! add n limbs returning carry */
+	static limb_t _add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+	/*! subtract n limbs returning borrow */
+	static limb_t _sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+	/*! compare n limbs scanning all of them */
+	static int _cmp(const limb_t *a, const limb_t *b, size_t n);
+
+	/*! r = (a & mask) | (b & ~mask) */
+	static void _select(limb_t *r, limb_t mask, const limb_t *a, const limb_t *b, size_t n);
+
+	/*! swap the limbs of a and b under mask */
+	static void _cswap(limb_t mask, limb_t *a, limb_t *b, size_t n);
+
+	/*! Montgomery product with a masked final subtraction, r may alias a or b */
+	static void _mont_mul(limb_t *r, const limb_t *a, const limb_t *b,
+		const MontgomeryContext &ctx, limb_t *t);
+
+	/*! number of scratch limbs needed by _mont_mul */
+	static size_t _mont_scratch(size_t n) { return 2 * n + 2; }
+};
+
+
+/*------------------------------.
+| constant time exponentiation. |
+`------------------------------*/
+
+/*!
+ * base^exp mod m by Montgomery ladder. every bit of the exp limbs, leading
+ * zeros included, costs one multiply, one square and one masked swap on
+ * the xor of the bit with the previous bit, plus one final swap.
+ * base has ctx.n limbs and may be unreduced; the result has ctx.n limbs.
+ */
+ConstTimeNat modpow(const ConstTimeNat &base, const ConstTimeNat &exp, const MontgomeryContext &ctx);
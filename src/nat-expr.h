@@ -0,0 +1,323 @@
+/*
+ * nat-expr.h
+ *
+ * expression templates for fused natural number operations
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "nat.h"
+
+/*
+ * lazy(x) starts an expression that is evaluated when it is converted to
+ * Nat or passed to assign(). the following chains are fused into a single
+ * pass writing straight into the destination:
+ *
+ *   lazy(a) * b + c            multiply-add
+ *   (lazy(x) << k) | y         shift-or
+ *   lazy(a) & ~lazy(b)         and-not
+ *   a + (lazy(x) << k)         add-with-shift
+ *
+ * results have the same value, signedness and width as the equivalent
+ * chain of Nat operators. converting to Nat allocates only the result
+ * and assign(r, expr) reuses the storage of r, which may alias any
+ * operand. expressions hold references to their operands so must not
+ * outlive the full expression that creates them.
+ */
+
+
+/*------------------.
+| expression nodes. |
+`------------------*/
+
+/*! reference to a Nat operand */
+struct NatRef
+{
+	const Nat &v;
+
+	operator const Nat&() const { return v; }
+};
+
+/*! a * b */
+struct NatMulExpr
+{
+	const Nat &a, &b;
+
+	void eval(Nat &r) const { Nat::mul_into(r, a, b); }
+	operator Nat() const { Nat r; eval(r); return r; }
+};
+
+/*! a * b + c */
+struct NatMulAddExpr
+{
+	const Nat &a, &b, &c;
+
+	void eval(Nat &r) const;
+	operator Nat() const { Nat r; eval(r); return r; }
+};
+
+/*! x << k */
+struct NatShlExpr
+{
+	const Nat &x;
+	size_t k;
+
+	void eval(Nat &r) const { r = x; r <<= k; }
+	operator Nat() const { return x << k; }
+};
+
+/*! (x << k) | y */
+struct NatShlOrExpr
+{
+	const Nat &x;
+	size_t k;
+	const Nat &y;
+
+	void eval(Nat &r) const;
+	operator Nat() const { Nat r; eval(r); return r; }
+};
+
+/*! ~b */
+struct NatNotExpr
+{
+	const Nat &b;
+
+	void eval(Nat &r) const { r = ~b; }
+	operator Nat() const { return ~b; }
+};
+
+/*! a & ~b */
+struct NatAndNotExpr
+{
+	const Nat &a, &b;
+
+	void eval(Nat &r) const;
+	operator Nat() const { Nat r; eval(r); return r; }
+};
+
+/*! a + (x << k) */
+struct NatAddShlExpr
+{
+	const Nat &a, &x;
+	size_t k;
+
+	void eval(Nat &r) const;
+	operator Nat() const { Nat r; eval(r); return r; }
+};
+
+
+/*----------------------.
+| expression operators. |
+`----------------------*/
+
+/*! start an expression */
+inline NatRef lazy(const Nat &v) { return NatRef{v}; }
+
+inline NatMulExpr operator*(NatRef a, const Nat &b) { return NatMulExpr{a.v, b}; }
+inline NatMulAddExpr operator+(NatMulExpr m, const Nat &c) { return NatMulAddExpr{m.a, m.b, c}; }
+inline NatShlExpr operator<<(NatRef x, size_t k) { return NatShlExpr{x.v, k}; }
+inline NatShlOrExpr operator|(NatShlExpr s, const Nat &y) { return NatShlOrExpr{s.x, s.k, y}; }
+inline NatNotExpr operator~(NatRef b) { return NatNotExpr{b.v}; }
+inline NatAndNotExpr operator&(NatRef a, NatNotExpr n) { return NatAndNotExpr{a.v, n.b}; }
+inline NatAndNotExpr operator&(const Nat &a, NatNotExpr n) { return NatAndNotExpr{a, n.b}; }
+inline NatAddShlExpr operator+(NatRef a, NatShlExpr s) { return NatAddShlExpr{a.v, s.x, s.k}; }
+inline NatAddShlExpr operator+(const Nat &a, NatShlExpr s) { return NatAddShlExpr{a, s.x, s.k}; }
+
+/*! evaluate an expression into existing storage */
+template <typename E>
+inline Nat& assign(Nat &r, const E &e)
+{
+	e.eval(r);
+	return r;
+}
+
+
+/*------------------.
+| fused evaluation. |
+`------------------*/
+
+/*! thread local copy buffer for operands aliased by the destination */
+inline Nat::scratch& nat_expr_scratch()
+{
+	static thread_local Nat::scratch ws;
+	return ws;
+}
+
+/*! limbs of x << k truncated to the width of x */
+struct NatShlLimbs
+{
+	const Nat::limb_t *p;
+	size_t n, w, b, max;
+	Nat::limb_t top;
+
+	NatShlLimbs(const Nat &x, const Nat::limb_t *xp, size_t k)
+		: p(xp), n(x.num_limbs()), w(k >> Nat::limb_shift), b(k & (Nat::limb_bits - 1)),
+		  max(x.max_limbs()), top(x.limb_mask(x.max_limbs() - 1)) {}
+
+	Nat::limb_t operator[](size_t i) const
+	{
+		if (i < w || i >= max) return 0;
+		size_t j = i - w;
+		Nat::limb_t lo = j < n ? p[j] << b : 0;
+		Nat::limb_t hi = b && j > 0 && j - 1 < n ? p[j - 1] >> (Nat::limb_bits - b) : 0;
+		return i == max - 1 ? (lo | hi) & top : lo | hi;
+	}
+};
+
+/*!
+ * multiply-add. small products accumulate rows of a * b[j] directly onto
+ * a copy of c in the destination; large products use mul_into then add.
+ */
+inline void NatMulAddExpr::eval(Nat &r) const
+{
+	size_t m = a.num_limbs(), n = b.num_limbs(), cn = c.num_limbs();
+	size_t k = std::min(a.max_limbs(), m + n);
+	size_t len = std::min(a.max_limbs(), std::max(k, cn) + 1);
+	bool alias = &r == &a || &r == &b;
+
+	if (!alias && std::min(m, n) < Nat::karatsuba_threshold) {
+		Nat::signedness s = a.s;
+		unsigned bits = a.bits;
+		if (&r != &c) {
+			r.limbs.reserve(len);
+			r.limbs.assign(c.limbs.data(), std::min(cn, len));
+		}
+		r._resize(len);
+		Nat::limb_t *rp = r.limbs.data();
+		const Nat::limb_t *ap = a.limbs.data(), *bp = b.limbs.data();
+		for (size_t j = 0; j < n && j < len; j++) {
+			size_t l = std::min(m, len - j);
+			Nat::limb_t carry = Nat::_addmul_1(rp + j, ap, l, bp[j]);
+			for (size_t i = j + l; carry && i < len; i++) {
+				rp[i] += carry;
+				carry = rp[i] < carry;
+			}
+		}
+		r.s = s;
+		r.bits = bits;
+		r._contract();
+		return;
+	}
+
+	if (&r == &c) {
+		if (c.s.is_signed == a.s.is_signed && c.bits == a.bits) {
+			Nat::mul_add_into(r, a, b);
+		} else {
+			Nat t;
+			Nat::mul_into(t, a, b);
+			t += c;
+			r = std::move(t);
+		}
+		return;
+	}
+	r.limbs.reserve(len);
+	Nat::mul_into(r, a, b);
+	r += c;
+}
+
+/*! shift-or, limbs are produced high to low so x may alias the destination */
+inline void NatShlOrExpr::eval(Nat &r) const
+{
+	size_t xn = x.num_limbs(), yn = y.num_limbs();
+	size_t w = k >> Nat::limb_shift;
+	size_t len = std::min(x.max_limbs(), std::max(xn + w + 1, yn));
+	Nat::signedness s = x.s;
+	unsigned bits = x.bits;
+
+	r._resize(len);
+	Nat::limb_t *rp = r.limbs.data();
+	NatShlLimbs xs(x, x.limbs.data(), k);
+	xs.n = xn; /* x may alias r which was extended */
+	const Nat::limb_t *yp = y.limbs.data();
+	for (size_t i = len; i-- > yn; ) {
+		rp[i] = xs[i];
+	}
+	for (size_t i = std::min(len, yn); i-- > 0; ) {
+		rp[i] = xs[i] | yp[i];
+	}
+	r.s = s;
+	r.bits = bits;
+	r._contract();
+}
+
+/*! and-not, matching a & ~b where ~b inverts within the width of b */
+inline void NatAndNotExpr::eval(Nat &r) const
+{
+	size_t an = a.num_limbs(), bn = b.num_limbs();
+	size_t bmax = b.bits ? b.max_limbs() : bn;
+	Nat::signedness s = a.s;
+	unsigned bits = a.bits;
+
+	r._resize(an);
+	Nat::limb_t *rp = r.limbs.data();
+	const Nat::limb_t *ap = a.limbs.data(), *bp = b.limbs.data();
+	size_t i = 0, l1 = std::min(an, bn), l2 = std::min(an, bmax);
+	for (; i < l1; i++) {
+		rp[i] = ap[i] & ~bp[i];
+	}
+	for (; i < l2; i++) {
+		rp[i] = ap[i];
+	}
+	for (; i < an; i++) {
+		rp[i] = 0;
+	}
+	if (b.bits && bmax <= an) {
+		rp[bmax - 1] &= b.limb_mask(bmax - 1);
+	}
+	r.s = s;
+	r.bits = bits;
+	r._contract();
+}
+
+/*! add-with-shift, a copy of x is taken if it aliases the destination */
+inline void NatAddShlExpr::eval(Nat &r) const
+{
+	size_t an = a.num_limbs(), xn = x.num_limbs();
+	size_t w = k >> Nat::limb_shift;
+	size_t xl = std::min(x.max_limbs(), xn + w + 1);
+	size_t len = std::min(a.max_limbs(), std::max(an, xl) + 1);
+	Nat::signedness s = a.s;
+	unsigned bits = a.bits;
+
+	const Nat::limb_t *xp = x.limbs.data();
+	if (&r == &x) {
+		Nat::limb_t *t = nat_expr_scratch().get(xn);
+		std::copy(xp, xp + xn, t);
+		xp = t;
+	}
+	NatShlLimbs xs(x, xp, k);
+	r._resize(len);
+	Nat::limb_t *rp = r.limbs.data();
+	const Nat::limb_t *ap = a.limbs.data();
+	Nat::limb_t carry = 0;
+	for (size_t i = 0; i < len; i++) {
+		Nat::limb_t al = i < an ? ap[i] : 0;
+		Nat::limb_t sum = al + xs[i];
+		Nat::limb_t c = sum < al;
+		rp[i] = sum + carry;
+		carry = c | (rp[i] < carry);
+	}
+	r.s = s;
+	r.bits = bits;
+	r._contract();
+}
@@ -0,0 +1,369 @@
+/*
+ * nat-fixed.h
+ *
+ * compile time fixed width natural number
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <array>
+
+#include "nat.h"
+
+/*! compile time loop calling f(i) for i in [I, E) */
+template <size_t I, size_t E, bool = (I < E)>
+struct fixed_unroll
+{
+	template <typename F> static inline void run(F &&f)
+	{
+		f(I);
+		fixed_unroll<I + 1, E>::run(f);
+	}
+};
+
+template <size_t I, size_t E>
+struct fixed_unroll<I, E, false>
+{
+	template <typename F> static inline void run(F &&) {}
+};
+
+/*!
+ * fixed width natural number with the width known at compile time.
+ *
+ * limbs are held in a std::array and the kernels are unrolled over the
+ * limb count. arithmetic wraps modulo 2^Bits, giving the same results as
+ * Nat with bits set to Bits and the same signedness.
+ */
+template <unsigned Bits, bool Signed = false>
+struct FixedNat
+{
+	static_assert(Bits > 0, "FixedNat requires at least one bit");
+
+	typedef Nat::limb_t limb_t;
+	typedef Nat::limb2_t limb2_t;
+
+	enum : size_t {
+		limb_bits = Nat::limb_bits,
+		num_limbs = (Bits + limb_bits - 1) / limb_bits,
+		top_bits = Bits - (num_limbs - 1) * limb_bits
+	};
+
+	/*! mask of the valid bits in the top limb */
+	static constexpr limb_t top_mask()
+	{
+		return top_bits == limb_bits ? limb_t(-1) : (limb_t(1) << (top_bits % limb_bits)) - 1;
+	}
+
+	/* limbs is an array of words with the little end at offset 0 */
+	std::array<limb_t, num_limbs> limbs;
+
+
+	/*--------------.
+	| constructors. |
+	`--------------*/
+
+	/*! default constructor */
+	FixedNat() : limbs() {}
+
+	/*! integral constructor */
+	FixedNat(limb_t n) : limbs()
+	{
+		limbs[0] = n;
+		_mask();
+	}
+
+	/*! array constructor */
+	FixedNat(std::initializer_list<limb_t> l) : limbs()
+	{
+		std::copy(l.begin(), l.begin() + std::min(l.size(), size_t(num_limbs)), limbs.begin());
+		_mask();
+	}
+
+	/*! Nat constructor, truncating or zero extending to Bits */
+	explicit FixedNat(const Nat &n) : limbs()
+	{
+		std::copy(n.limbs.begin(), n.limbs.begin() + std::min(n.num_limbs(), size_t(num_limbs)), limbs.begin());
+		_mask();
+	}
+
+	/*! string constructor */
+	explicit FixedNat(std::string str, size_t radix = 0)
+		: FixedNat(Nat(str, radix)) {}
+
+	/*! convert to Nat with bits set to Bits */
+	Nat to_nat() const
+	{
+		Nat r(0, Signed ? Nat::_signed : Nat::_unsigned, Bits);
+		r._resize(num_limbs);
+		std::copy(limbs.begin(), limbs.end(), r.limbs.begin());
+		r._contract();
+		return r;
+	}
+
+	/*! convert to string */
+	std::string to_string(size_t radix = 10) const { return to_nat().to_string(radix); }
+
+
+	/*------------------.
+	| internal methods. |
+	`------------------*/
+
+	/*! clear bits above Bits in the top limb */
+	void _mask() { limbs[num_limbs - 1] &= top_mask(); }
+
+	/*! top limb with the sign extended through the unused bits */
+	limb_t _top_ext() const
+	{
+		limb_t t = limbs[num_limbs - 1];
+		return Signed && sign_bit() ? t | ~top_mask() : t;
+	}
+
+
+	/*-------------------------------.
+	| limb and bit accessor methods. |
+	`-------------------------------*/
+
+	/*! access word at limb offset */
+	limb_t limb_at(size_t n) const { return n < num_limbs ? limbs[n] : 0; }
+
+	/*! test bit at bit offset */
+	int test_bit(size_t n) const
+	{
+		return n < Bits ? (limbs[n / limb_bits] >> (n % limb_bits)) & 1 : 0;
+	}
+
+	/*! set bit at bit offset */
+	void set_bit(size_t n)
+	{
+		if (n < Bits) limbs[n / limb_bits] |= limb_t(1) << (n % limb_bits);
+	}
+
+	/*! test sign */
+	bool sign_bit() const { return test_bit(Bits - 1); }
+
+
+	/*---------------------------------------------.
+	| add, subtract, shifts and logical operators. |
+	`---------------------------------------------*/
+
+	/*! add with carry equals */
+	FixedNat& operator+=(const FixedNat &operand)
+	{
+		limb_t carry = 0;
+		fixed_unroll<0, num_limbs>::run([&](size_t i) {
+			limb2_t t = limb2_t(limbs[i]) + operand.limbs[i] + carry;
+			limbs[i] = limb_t(t);
+			carry = limb_t(t >> limb_bits);
+		});
+		_mask();
+		return *this;
+	}
+
+	/*! subtract with borrow equals */
+	FixedNat& operator-=(const FixedNat &operand)
+	{
+		limb_t borrow = 0;
+		fixed_unroll<0, num_limbs>::run([&](size_t i) {
+			limb2_t t = limb2_t(limbs[i]) - operand.limbs[i] - borrow;
+			limbs[i] = limb_t(t);
+			borrow = limb_t(t >> limb_bits) & 1;
+		});
+		_mask();
+		return *this;
+	}
+
+	/*! left shift equals */
+	FixedNat& operator<<=(size_t shamt)
+	{
+		FixedNat r;
+		size_t w = shamt / limb_bits, b = shamt % limb_bits;
+		if (shamt < Bits) {
+			fixed_unroll<0, num_limbs>::run([&](size_t i) {
+				limb_t lo = i >= w ? limbs[i - w] << b : 0;
+				limb_t hi = i >= w + 1 && b ? limbs[i - w - 1] >> (limb_bits - b) : 0;
+				r.limbs[i] = lo | hi;
+			});
+		}
+		r._mask();
+		return *this = r;
+	}
+
+	/*! right shift equals, sign filling if Signed */
+	FixedNat& operator>>=(size_t shamt)
+	{
+		FixedNat r;
+		limb_t fill = Signed && sign_bit() ? limb_t(-1) : 0;
+		limb_t top = _top_ext();
+		auto get = [&](size_t j) {
+			return j < num_limbs - 1 ? limbs[j] : j == num_limbs - 1 ? top : fill;
+		};
+		size_t w = shamt / limb_bits, b = shamt % limb_bits;
+		if (shamt < Bits) {
+			fixed_unroll<0, num_limbs>::run([&](size_t i) {
+				limb_t lo = get(i + w) >> b;
+				limb_t hi = b ? get(i + w + 1) << (limb_bits - b) : 0;
+				r.limbs[i] = lo | hi;
+			});
+		} else {
+			r.limbs.fill(fill);
+		}
+		r._mask();
+		return *this = r;
+	}
+
+	/*! bitwise and equals */
+	FixedNat& operator&=(const FixedNat &operand)
+	{
+		fixed_unroll<0, num_limbs>::run([&](size_t i) { limbs[i] &= operand.limbs[i]; });
+		return *this;
+	}
+
+	/*! bitwise or equals */
+	FixedNat& operator|=(const FixedNat &operand)
+	{
+		fixed_unroll<0, num_limbs>::run([&](size_t i) { limbs[i] |= operand.limbs[i]; });
+		return *this;
+	}
+
+	/*! bitwise xor equals */
+	FixedNat& operator^=(const FixedNat &operand)
+	{
+		fixed_unroll<0, num_limbs>::run([&](size_t i) { limbs[i] ^= operand.limbs[i]; });
+		return *this;
+	}
+
+	/*! add with carry */
+	FixedNat operator+(const FixedNat &operand) const { FixedNat r(*this); return r += operand; }
+
+	/*! subtract with borrow */
+	FixedNat operator-(const FixedNat &operand) const { FixedNat r(*this); return r -= operand; }
+
+	/*! left shift */
+	FixedNat operator<<(size_t shamt) const { FixedNat r(*this); return r <<= shamt; }
+
+	/*! right shift */
+	FixedNat operator>>(size_t shamt) const { FixedNat r(*this); return r >>= shamt; }
+
+	/*! bitwise and */
+	FixedNat operator&(const FixedNat &operand) const { FixedNat r(*this); return r &= operand; }
+
+	/*! bitwise or */
+	FixedNat operator|(const FixedNat &operand) const { FixedNat r(*this); return r |= operand; }
+
+	/*! bitwise xor */
+	FixedNat operator^(const FixedNat &operand) const { FixedNat r(*this); return r ^= operand; }
+
+	/*! bitwise not */
+	FixedNat operator~() const
+	{
+		FixedNat r;
+		fixed_unroll<0, num_limbs>::run([&](size_t i) { r.limbs[i] = ~limbs[i]; });
+		r._mask();
+		return r;
+	}
+
+	/*! negate */
+	FixedNat operator-() const { return FixedNat() - *this; }
+
+
+	/*----------------------.
+	| comparison operators. |
+	`----------------------*/
+
+	/*! equals */
+	bool operator==(const FixedNat &operand) const { return limbs == operand.limbs; }
+
+	/*! less than, two's complement ordering if Signed */
+	bool operator<(const FixedNat &operand) const
+	{
+		if (Signed && sign_bit() != operand.sign_bit()) {
+			return sign_bit();
+		}
+		for (size_t i = num_limbs; i-- > 0; ) {
+			if (limbs[i] != operand.limbs[i]) return limbs[i] < operand.limbs[i];
+		}
+		return false;
+	}
+
+	/*! not equals */
+	bool operator!=(const FixedNat &operand) const { return !(*this == operand); }
+
+	/*! less than or equal */
+	bool operator<=(const FixedNat &operand) const { return !(operand < *this); }
+
+	/*! greater than */
+	bool operator>(const FixedNat &operand) const { return operand < *this; }
+
+	/*! greater than or equal */
+	bool operator>=(const FixedNat &operand) const { return !(*this < operand); }
+
+	/*! not */
+	bool operator!() const { return *this == FixedNat(); }
+
+
+	/*-------------------------.
+	| multply, divide and pow. |
+	`-------------------------*/
+
+	/*! multiply equals, keeping the low Bits of the product */
+	FixedNat& operator*=(const FixedNat &operand)
+	{
+		FixedNat r;
+		fixed_unroll<0, num_limbs>::run([&](size_t j) {
+			limb_t carry = 0;
+			limb2_t mj = operand.limbs[j];
+			for (size_t i = 0; i + j < num_limbs; i++) {
+				limb2_t t = limb2_t(limbs[i]) * mj + r.limbs[i + j] + carry;
+				r.limbs[i + j] = limb_t(t);
+				carry = limb_t(t >> limb_bits);
+			}
+		});
+		r._mask();
+		return *this = r;
+	}
+
+	/*! divide equals, via Nat */
+	FixedNat& operator/=(const FixedNat &operand) { return *this = FixedNat(to_nat() / operand.to_nat()); }
+
+	/*! modulus equals, via Nat */
+	FixedNat& operator%=(const FixedNat &operand) { return *this = FixedNat(to_nat() % operand.to_nat()); }
+
+	/*! multiply */
+	FixedNat operator*(const FixedNat &operand) const { FixedNat r(*this); return r *= operand; }
+
+	/*! division quotient */
+	FixedNat operator/(const FixedNat &divisor) const { FixedNat r(*this); return r /= divisor; }
+
+	/*! division remainder */
+	FixedNat operator%(const FixedNat &divisor) const { FixedNat r(*this); return r %= divisor; }
+
+	/*! raise to the power */
+	FixedNat pow(size_t exp) const
+	{
+		FixedNat x(*this), y(1);
+		for (; exp; exp >>= 1, x *= x) {
+			if (exp & 1) y *= x;
+		}
+		return y;
+	}
+};
@@ -0,0 +1,469 @@
+/*
+ * nat-mod.cc
+ *
+ * modular arithmetic for natural numbers
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdexcept>
+
+#include "nat-mod.h"
+
+using limb_t = Nat::limb_t;
+using limb2_t = Nat::limb2_t;
+
+
+/*--------------------.
+| montgomery context. |
+`--------------------*/
+
+size_t MontgomeryContext::redc_threshold = Nat::limb_bits == 64 ? 16 : 192;
+size_t MontgomeryContext::redc_sqr_threshold = Nat::limb_bits == 64 ? 4 : 16;
+
+/*! copy a reduced value into n zero padded limbs */
+static void _load(limb_t *r, const Nat &a, size_t n)
+{
+	size_t an = std::min(a.num_limbs(), n);
+	std::copy(a.limbs.data(), a.limbs.data() + an, r);
+	std::fill(r + an, r + n, limb_t(0));
+}
+
+/*! variable width Nat from n limbs */
+static Nat _store(const limb_t *a, size_t n)
+{
+	Nat r;
+	r.limbs.assign(a, n);
+	r._contract();
+	return r;
+}
+
+/*! construct from an odd modulus */
+MontgomeryContext::MontgomeryContext(const Nat &modulus) : n(0), minv(0)
+{
+	m.limbs = modulus.limbs;
+	m._contract();
+	if ((m.limb_at(0) & 1) == 0) {
+		throw std::invalid_argument("MontgomeryContext requires an odd modulus");
+	}
+	n = m.num_limbs();
+
+	/* Newton iteration x' = x(2 - mx) doubles the bits of m^-1 mod 2^k,
+	 * starting from x = m which is correct to 3 bits for odd m */
+	limb_t m0 = m.limbs[0], x = m0;
+	for (size_t bits = 3; bits < Nat::limb_bits; bits <<= 1) {
+		x *= 2 - m0 * x;
+	}
+	minv = limb_t(0) - x;
+	r2 = (Nat(1) << (2 * n * Nat::limb_bits)) % m;
+}
+
+/*!
+ * coarsely integrated operand scanning (Koc et al). each limb of b
+ * accumulates a * b[i] into t, then one multiple of m clears the low
+ * limb of t, which is shifted down a limb in the same pass.
+ */
+void MontgomeryContext::_mul_cios(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const
+{
+	const limb_t *mp = m.limbs.data();
+	std::fill(t, t + n + 2, limb_t(0));
+	for (size_t i = 0; i < n; i++) {
+		limb_t c = Nat::_addmul_1(t, a, n, b[i]);
+		limb2_t s = limb2_t(t[n]) + c;
+		t[n] = limb_t(s);
+		t[n + 1] = limb_t(s >> Nat::limb_bits);
+
+		limb_t u = t[0] * minv;
+		limb2_t p = limb2_t(u) * mp[0] + t[0];
+		c = limb_t(p >> Nat::limb_bits);
+		for (size_t j = 1; j < n; j++) {
+			p = limb2_t(u) * mp[j] + t[j] + c;
+			t[j - 1] = limb_t(p);
+			c = limb_t(p >> Nat::limb_bits);
+		}
+		s = limb2_t(t[n]) + c;
+		t[n - 1] = limb_t(s);
+		t[n] = t[n + 1] + limb_t(s >> Nat::limb_bits);
+	}
+	if (t[n] || Nat::_cmp(t, n, mp, n) >= 0) {
+		Nat::_sub_n(r, t, mp, n);
+	} else {
+		std::copy(t, t + n, r);
+	}
+}
+
+/*!
+ * finely integrated operand scanning. the multiply and reduce steps share
+ * one inner loop with separate carries, t holds n + 1 limbs below 2m.
+ */
+void MontgomeryContext::_mul_fios(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const
+{
+	const limb_t *mp = m.limbs.data();
+	std::fill(t, t + n + 1, limb_t(0));
+	for (size_t i = 0; i < n; i++) {
+		limb2_t p = limb2_t(a[0]) * b[i] + t[0];
+		limb_t u = limb_t(p) * minv;
+		limb2_t q = limb2_t(u) * mp[0] + limb_t(p);
+		limb_t c1 = limb_t(p >> Nat::limb_bits), c2 = limb_t(q >> Nat::limb_bits);
+		for (size_t j = 1; j < n; j++) {
+			p = limb2_t(a[j]) * b[i] + t[j] + c1;
+			c1 = limb_t(p >> Nat::limb_bits);
+			q = limb2_t(u) * mp[j] + limb_t(p) + c2;
+			c2 = limb_t(q >> Nat::limb_bits);
+			t[j - 1] = limb_t(q);
+		}
+		limb2_t s = limb2_t(t[n]) + c1 + c2;
+		t[n - 1] = limb_t(s);
+		t[n] = limb_t(s >> Nat::limb_bits);
+	}
+	if (t[n] || Nat::_cmp(t, n, mp, n) >= 0) {
+		Nat::_sub_n(r, t, mp, n);
+	} else {
+		std::copy(t, t + n, r);
+	}
+}
+
+/*!
+ * separated Montgomery reduction. each row adds a multiple of m clearing
+ * one low limb of t, with the row carries accumulated into the high half.
+ */
+void MontgomeryContext::_redc(limb_t *r, limb_t *t) const
+{
+	const limb_t *mp = m.limbs.data();
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb_t c = Nat::_addmul_1(t + i, mp, n, t[i] * minv);
+		limb2_t s = limb2_t(t[i + n]) + c + carry;
+		t[i + n] = limb_t(s);
+		carry = limb_t(s >> Nat::limb_bits);
+	}
+	if (carry || Nat::_cmp(t + n, n, mp, n) >= 0) {
+		Nat::_sub_n(r, t + n, mp, n);
+	} else {
+		std::copy(t + n, t + 2 * n, r);
+	}
+}
+
+/*!
+ * Montgomery product selecting kernel by size. the fused loop of FIOS is
+ * fastest with 32-bit limbs, while with 64-bit limbs its two 128-bit carry
+ * chains lose to CIOS, which reuses _addmul_1 for the product rows.
+ */
+void MontgomeryContext::_mul(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const
+{
+	if (n < redc_threshold) {
+		if (Nat::limb_bits == 64) {
+			_mul_cios(r, a, b, t);
+		} else {
+			_mul_fios(r, a, b, t);
+		}
+	} else {
+		Nat::_mul(t, a, n, b, n, t + 2 * n);
+		_redc(r, t);
+	}
+}
+
+/*! Montgomery square selecting kernel by size */
+void MontgomeryContext::_sqr(limb_t *r, const limb_t *a, limb_t *t) const
+{
+	if (n < redc_sqr_threshold) {
+		_mul(r, a, a, t);
+	} else {
+		Nat::_sqr(t, a, n, t + 2 * n);
+		_redc(r, t);
+	}
+}
+
+/*! number of scratch limbs needed by _mul and _sqr */
+size_t MontgomeryContext::_scratch() const
+{
+	return 2 * n + std::max(Nat::_mul_scratch(n, n), Nat::_sqr_scratch(n)) + 2;
+}
+
+/*! convert a to Montgomery form */
+Nat MontgomeryContext::to_mont(const Nat &a) const
+{
+	return mul(a < m ? a : a % m, r2);
+}
+
+/*! convert from Montgomery form */
+Nat MontgomeryContext::from_mont(const Nat &a) const
+{
+	Nat::limb_vector t;
+	t.resize(_scratch());
+	_load(t.data(), a, n);
+	std::fill(t.data() + n, t.data() + 2 * n, limb_t(0));
+	_redc(t.data(), t.data());
+	return _store(t.data(), n);
+}
+
+/*! Montgomery product */
+Nat MontgomeryContext::mul(const Nat &a, const Nat &b) const
+{
+	Nat::limb_vector t;
+	t.resize(_scratch() + 2 * n);
+	limb_t *ap = t.data(), *bp = ap + n, *ws = bp + n;
+	_load(ap, a, n);
+	_load(bp, b, n);
+	_mul(ap, ap, bp, ws);
+	return _store(ap, n);
+}
+
+/*! Montgomery square */
+Nat MontgomeryContext::sqr(const Nat &a) const
+{
+	Nat::limb_vector t;
+	t.resize(_scratch() + n);
+	limb_t *ap = t.data(), *ws = ap + n;
+	_load(ap, a, n);
+	_sqr(ap, ap, ws);
+	return _store(ap, n);
+}
+
+
+/*-----------------.
+| barrett context. |
+`-----------------*/
+
+size_t BarrettContext::div_threshold = 96;
+
+/*! construct from a nonzero modulus */
+BarrettContext::BarrettContext(const Nat &modulus) : n(0), div(modulus)
+{
+	m.limbs = modulus.limbs;
+	m._contract();
+	if (m == 0) {
+		throw std::invalid_argument("BarrettContext requires a nonzero modulus");
+	}
+	n = m.num_limbs();
+	mu = (Nat(1) << (2 * n * Nat::limb_bits)) / m;
+}
+
+/*!
+ * the estimate q3 = floor(floor(t / b^(n-1)) * mu / b^(n+1)) is below
+ * floor(t / m) by at most two (HAC 14.42), and fits in n + 1 limbs so
+ * t - q3 * m is found modulo b^(n+1) from the low limbs alone. both
+ * products are truncated to the limbs that are used, and partial products
+ * of q1 * mu below limb n - 1 are dropped, lowering q3 by at most one more,
+ * which the final subtraction loop corrects.
+ *
+ * truncated schoolbook products cost about one n by n product, so from
+ * div_threshold limbs the divide and conquer division kernel, which is
+ * subquadratic, finds the remainder using the precomputed divisor.
+ */
+void BarrettContext::_reduce(limb_t *r, const limb_t *t, limb_t *ws) const
+{
+	if (n >= div_threshold) {
+		int s = div.shift;
+		limb_t *u = ws, *q = u + 2 * n + 1, *ws2 = q + n + 1;
+		u[2 * n] = s ? t[2 * n - 1] >> (Nat::limb_bits - s) : 0;
+		for (size_t i = 2 * n - 1; i > 0; i--) {
+			u[i] = (t[i] << s) | (s ? t[i - 1] >> (Nat::limb_bits - s) : 0);
+		}
+		u[0] = t[0] << s;
+		Nat::_div(q, u, 2 * n + 1, div.d.data(), n, div.dinv, ws2);
+		for (size_t i = 0; i < n; i++) {
+			r[i] = (u[i] >> s) | (s && i + 1 < n ? u[i + 1] << (Nat::limb_bits - s) : 0);
+		}
+		return;
+	}
+
+	const limb_t *mp = m.limbs.data(), *up = mu.limbs.data(), *q1 = t + n - 1;
+	size_t mun = mu.num_limbs();
+	limb_t *q2 = ws, *q3 = q2 + n + 1, *qm = q3 + mun;
+
+	std::fill(q2 + n - 1, q2 + n + 1, limb_t(0));
+	for (size_t j = 0; j < mun; j++) {
+		size_t i = j < n - 1 ? n - 1 - j : 0;
+		q2[j + n + 1] = Nat::_addmul_1(q2 + i + j, q1 + i, n + 1 - i, up[j]);
+	}
+	std::fill(qm, qm + n + 1, limb_t(0));
+	for (size_t j = 0; j < n; j++) {
+		Nat::_addmul_1(qm + j, q3, n + 1 - j, mp[j]);
+	}
+	Nat::_sub_n(qm, t, qm, n + 1);
+	while (qm[n] || Nat::_cmp(qm, n, mp, n) >= 0) {
+		qm[n] -= Nat::_sub_n(qm, qm, mp, n);
+	}
+	std::copy(qm, qm + n, r);
+}
+
+/*! modular product */
+void BarrettContext::_mul(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const
+{
+	Nat::_mul(t, a, n, b, n, t + 2 * n);
+	_reduce(r, t, t + 2 * n);
+}
+
+/*! modular square */
+void BarrettContext::_sqr(limb_t *r, const limb_t *a, limb_t *t) const
+{
+	Nat::_sqr(t, a, n, t + 2 * n);
+	_reduce(r, t, t + 2 * n);
+}
+
+/*! number of scratch limbs needed by _reduce */
+size_t BarrettContext::_reduce_scratch() const
+{
+	if (n >= div_threshold) {
+		return (2 * n + 1) + (n + 1) + Nat::_div_scratch(2 * n + 1, n);
+	}
+	return (n + 1 + mu.num_limbs()) + (n + 1);
+}
+
+/*! number of scratch limbs needed by _mul and _sqr */
+size_t BarrettContext::_scratch() const
+{
+	return 2 * n + std::max(std::max(Nat::_mul_scratch(n, n), Nat::_sqr_scratch(n)),
+		_reduce_scratch());
+}
+
+/*! x mod m */
+Nat BarrettContext::reduce(const Nat &x) const
+{
+	size_t xn = x.num_limbs();
+	if (xn > 2 * n) {
+		return x % m;
+	}
+	if (xn < n || (xn == n && x < m)) {
+		Nat r;
+		r.limbs = x.limbs;
+		r._contract();
+		return r;
+	}
+	Nat::limb_vector t;
+	t.resize(2 * n + _reduce_scratch());
+	_load(t.data(), x, 2 * n);
+	_reduce(t.data(), t.data(), t.data() + 2 * n);
+	return _store(t.data(), n);
+}
+
+/*! ab mod m */
+Nat BarrettContext::mulmod(const Nat &a, const Nat &b) const
+{
+	Nat::limb_vector t;
+	t.resize(_scratch() + 2 * n);
+	limb_t *ap = t.data(), *bp = ap + n, *ws = bp + n;
+	_load(ap, a, n);
+	_load(bp, b, n);
+	_mul(ap, ap, bp, ws);
+	return _store(ap, n);
+}
+
+
+/*------------------------.
+| modular exponentiation. |
+`------------------------*/
+
+/*! window size for sliding window exponentiation of an exponent of nb bits */
+static size_t _window_bits(size_t nb)
+{
+	return nb > 671 ? 6 : nb > 239 ? 5 : nb > 79 ? 4 : nb > 23 ? 3 : nb > 5 ? 2 : 1;
+}
+
+/*!
+ * sliding window exponentiation. the odd powers base^1, base^3 ...
+ * base^(2^k - 1) are precomputed from base in tab, then the exponent
+ * is scanned from the top, squaring per bit and multiplying once per
+ * window of up to k bits ending in a set bit. the context supplies the
+ * modular _mul and _sqr kernels and the representation of tab and x.
+ */
+template <typename Context>
+static void _modpow_window(const Context &ctx, limb_t *x, limb_t *tab,
+	const Nat &exp, size_t k, limb_t *ws)
+{
+	size_t n = ctx.n, nb = exp.num_bits(), tn = size_t(1) << (k - 1);
+	if (tn > 1) {
+		limb_t *b2 = tab + tn * n;
+		ctx._sqr(b2, tab, ws);
+		for (size_t i = 1; i < tn; i++) {
+			ctx._mul(tab + i * n, tab + (i - 1) * n, b2, ws);
+		}
+	}
+
+	bool first = true;
+	for (ptrdiff_t i = ptrdiff_t(nb) - 1; i >= 0; ) {
+		if (!exp.test_bit(i)) {
+			ctx._sqr(x, x, ws);
+			i--;
+			continue;
+		}
+		ptrdiff_t j = std::max(i - ptrdiff_t(k) + 1, ptrdiff_t(0));
+		while (!exp.test_bit(j)) {
+			j++;
+		}
+		size_t w = 0;
+		for (ptrdiff_t l = i; l >= j; l--) {
+			w = (w << 1) | exp.test_bit(l);
+		}
+		if (first) {
+			std::copy(tab + (w >> 1) * n, tab + (w >> 1) * n + n, x);
+			first = false;
+		} else {
+			for (ptrdiff_t l = i; l >= j; l--) {
+				ctx._sqr(x, x, ws);
+			}
+			ctx._mul(x, x, tab + (w >> 1) * n, ws);
+		}
+		i = j - 1;
+	}
+}
+
+/*! base^exp mod m with the table and result in Montgomery form */
+Nat modpow(const Nat &base, const Nat &exp, const MontgomeryContext &ctx)
+{
+	/* a fixed width exponent would be scanned over its full width */
+	Nat e = _store(exp.limbs.data(), exp.num_limbs());
+	size_t n = ctx.n, nb = e.num_bits();
+	if (ctx.m == 1) return 0;
+	if (nb == 0) return 1;
+
+	size_t k = _window_bits(nb), tn = size_t(1) << (k - 1);
+	Nat::limb_vector buf;
+	buf.resize((tn + 2) * n + ctx._scratch());
+	limb_t *tab = buf.data(), *x = tab + (tn + 1) * n, *ws = x + n;
+
+	_load(tab, ctx.to_mont(base), n);
+	_modpow_window(ctx, x, tab, e, k, ws);
+
+	std::fill(ws, ws + 2 * n, limb_t(0));
+	std::copy(x, x + n, ws);
+	ctx._redc(x, ws);
+	return _store(x, n);
+}
+
+/*! base^exp mod m with the table and result as plain residues */
+Nat modpow(const Nat &base, const Nat &exp, const BarrettContext &ctx)
+{
+	Nat e = _store(exp.limbs.data(), exp.num_limbs());
+	size_t n = ctx.n, nb = e.num_bits();
+	if (ctx.m == 1) return 0;
+	if (nb == 0) return 1;
+
+	size_t k = _window_bits(nb), tn = size_t(1) << (k - 1);
+	Nat::limb_vector buf;
+	buf.resize((tn + 2) * n + ctx._scratch());
+	limb_t *tab = buf.data(), *x = tab + (tn + 1) * n, *ws = x + n;
+
+	_load(tab, ctx.reduce(base), n);
+	_modpow_window(ctx, x, tab, e, k, ws);
+	return _store(x, n);
+}
@@ -0,0 +1,174 @@
+/*
+ * nat-mod.h
+ *
+ * modular arithmetic for natural numbers
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "nat.h"
+
+/*
+ * modular contexts precompute the constants for a fixed modulus so
+ * repeated multiplication and exponentiation avoid long division.
+ * MontgomeryContext requires an odd modulus, BarrettContext accepts
+ * any nonzero modulus including even moduli and powers of ten.
+ * values passed to context methods are reduced (less than the modulus)
+ * and results are variable width unsigned Nat.
+ */
+
+
+/*--------------------.
+| montgomery context. |
+`--------------------*/
+
+/*!
+ * Montgomery arithmetic modulo an odd m of n limbs with R = 2^(limb_bits * n).
+ * values in Montgomery form are stored as aR mod m, and mul(aR, bR) gives
+ * abR mod m using multiplies and shifts only.
+ */
+struct MontgomeryContext
+{
+	typedef Nat::limb_t limb_t;
+
+	/*! odd modulus */
+	Nat m;
+
+	/*! number of limbs in the modulus */
+	size_t n;
+
+	/*! -m^-1 mod 2^limb_bits */
+	limb_t minv;
+
+	/*! R^2 mod m */
+	Nat r2;
+
+	/*! modulus limbs at which products switch to multiply then reduce */
+	static size_t redc_threshold;
+
+	/*! modulus limbs at which squares switch to square then reduce */
+	static size_t redc_sqr_threshold;
+
+	/*! construct from an odd modulus, throws std::invalid_argument if even */
+	explicit MontgomeryContext(const Nat &modulus);
+
+	/*! convert a to Montgomery form aR mod m, a may be unreduced */
+	Nat to_mont(const Nat &a) const;
+
+	/*! convert aR from Montgomery form to a */
+	Nat from_mont(const Nat &a) const;
+
+	/*! Montgomery product abR^-1 mod m */
+	Nat mul(const Nat &a, const Nat &b) const;
+
+	/*! Montgomery square a^2R^-1 mod m */
+	Nat sqr(const Nat &a) const;
+
+	/* kernels operate on n limb arrays of reduced values and do not allocate */
+
+	/*! Montgomery product, coarsely integrated operand scanning */
+	void _mul_cios(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const;
+
+	/*! Montgomery product, finely integrated operand scanning */
+	void _mul_fios(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const;
+
+	/*! Montgomery reduction of 2n limbs of t into n limbs of r */
+	void _redc(limb_t *r, limb_t *t) const;
+
+	/*! Montgomery product selecting kernel by size, r may alias a or b */
+	void _mul(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const;
+
+	/*! Montgomery square selecting kernel by size, r may alias a */
+	void _sqr(limb_t *r, const limb_t *a, limb_t *t) const;
+
+	/*! number of scratch limbs needed by _mul and _sqr */
+	size_t _scratch() const;
+};
+
+
+/*-----------------.
+| barrett context. |
+`-----------------*/
+
+/*!
+ * Barrett reduction modulo any nonzero m of n limbs with b = 2^limb_bits.
+ * mu = floor(b^2n / m) estimates the quotient of x < b^2n to within two,
+ * plus one for the dropped partial products of the truncated estimate, so
+ * reduction costs two multiplications and at most three subtractions.
+ */
+struct BarrettContext
+{
+	typedef Nat::limb_t limb_t;
+
+	/*! nonzero modulus */
+	Nat m;
+
+	/*! number of limbs in the modulus */
+	size_t n;
+
+	/*! floor(b^2n / m) */
+	Nat mu;
+
+	/*! precomputed divisor for moduli of div_threshold limbs or more */
+	Nat::Divisor div;
+
+	/*! modulus limbs at which reduction switches to the division kernel */
+	static size_t div_threshold;
+
+	/*! construct from a nonzero modulus, throws std::invalid_argument if zero */
+	explicit BarrettContext(const Nat &modulus);
+
+	/*! x mod m, x of up to 2n limbs uses Barrett reduction, larger x divrem */
+	Nat reduce(const Nat &x) const;
+
+	/*! ab mod m for reduced a and b */
+	Nat mulmod(const Nat &a, const Nat &b) const;
+
+	/* kernels operate on n limb arrays of reduced values and do not allocate */
+
+	/*! Barrett reduction of 2n limbs of t into n limbs of r */
+	void _reduce(limb_t *r, const limb_t *t, limb_t *ws) const;
+
+	/*! modular product, r may alias a or b */
+	void _mul(limb_t *r, const limb_t *a, const limb_t *b, limb_t *t) const;
+
+	/*! modular square, r may alias a */
+	void _sqr(limb_t *r, const limb_t *a, limb_t *t) const;
+
+	/*! number of scratch limbs needed by _reduce */
+	size_t _reduce_scratch() const;
+
+	/*! number of scratch limbs needed by _mul and _sqr */
+	size_t _scratch() const;
+};
+
+
+/*------------------------.
+| modular exponentiation. |
+`------------------------*/
+
+/*! base^exp mod m using sliding window exponentiation in Montgomery form */
+Nat modpow(const Nat &base, const Nat &exp, const MontgomeryContext &ctx);
+
+/*! base^exp mod m using sliding window exponentiation with Barrett reduction */
+Nat modpow(const Nat &base, const Nat &exp, const BarrettContext &ctx);
@@ -0,0 +1,1064 @@
+/*
+ * nat-num.cc
+ *
+ * number theoretic functions for natural numbers
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "nat-num.h"
+#include "nat-mod.h"
+
+using limb_t = Nat::limb_t;
+using limb2_t = Nat::limb2_t;
+
+/*! variable width copy */
+static Nat _var(const Nat &a)
+{
+	Nat r;
+	r.limbs = a.limbs;
+	r._contract();
+	return r;
+}
+
+/*! primes below n by a sieve of the odd numbers */
+static std::vector<size_t> _primes_below(size_t n)
+{
+	std::vector<size_t> primes;
+	if (n > 2) primes.push_back(2);
+	std::vector<bool> composite(n / 2);
+	for (size_t p = 3; p < n; p += 2) {
+		if (composite[p / 2]) continue;
+		primes.push_back(p);
+		for (size_t j = p * p; j < n; j += 2 * p) composite[j / 2] = true;
+	}
+	return primes;
+}
+
+
+/*--------------.
+| lehmer steps. |
+`--------------*/
+
+/*
+ * the gcd is found by reducing the larger of (a, b) by a multiple of the
+ * smaller, so the inputs are (A; B) = M (a; b) for a cofactor matrix
+ * M = [u0 u1; v0 v1] with non-negative entries and determinant one.
+ * a -= q*b multiplies M on the right by [1 q; 0 1] and b -= q*a by
+ * [1 0; q 1], and (a; b) = M^-1 (A; B) = (v1 A - u1 B; u0 B - v0 A).
+ *
+ * a matrix found from the high parts A >> p and B >> p reduced to x and
+ * y is also valid for A and B, giving non-negative results, as long as
+ * x and y are at least the largest entry of M (Moller, Lemma 4). both
+ * Lehmer and half gcd steps stop reducing at half the input size, which
+ * guarantees this.
+ */
+
+/*! single limb cofactor matrix */
+struct _matrix1 { limb_t u0, u1, v0, v1; };
+
+/*! multi limb cofactor matrix */
+struct _matrix { Nat u0, u1, v0, v1; };
+
+/*! limb_bits bits of a starting at bit p */
+static limb_t _bits_at(const Nat &a, size_t p)
+{
+	size_t w = p / Nat::limb_bits, s = p % Nat::limb_bits;
+	limb_t lo = a.limb_at(w) >> s;
+	limb_t hi = s ? a.limb_at(w + 1) << (Nat::limb_bits - s) : 0;
+	return lo | hi;
+}
+
+/*!
+ * reduce the top limbs ah and bh while both stay at least 2^(limb_bits/2 + 1),
+ * so the entries of M stay below 2^(limb_bits/2 - 1). returns false if no
+ * step was possible. a remainder below the bound is taken as one multiple
+ * of the divisor less, after which no further step is possible.
+ */
+static bool _hgcd_1(limb_t ah, limb_t bh, _matrix1 &M)
+{
+	const limb_t lim = limb_t(1) << (Nat::limb_bits / 2 + 1);
+	bool progress = false;
+	M = _matrix1{1, 0, 0, 1};
+	while (ah >= lim && bh >= lim) {
+		bool swap = ah < bh;
+		limb_t &x = swap ? bh : ah, y = swap ? ah : bh;
+		limb_t q = x / y, r = x - q * y;
+		bool last = r < lim;
+		if (last) {
+			if (q == 1) break;
+			q--;
+			r += y;
+		}
+		x = r;
+		if (swap) {
+			M.u0 += q * M.u1;
+			M.v0 += q * M.v1;
+		} else {
+			M.u1 += q * M.u0;
+			M.v1 += q * M.v0;
+		}
+		progress = true;
+		if (last) break;
+	}
+	return progress;
+}
+
+/*! (a; b) <- M^-1 (a; b) in place using single limb multiplies */
+static void _apply_1(Nat &a, Nat &b, const _matrix1 &M, Nat::limb_vector &t)
+{
+	size_t n = std::max(a.num_limbs(), b.num_limbs());
+	a._resize(n);
+	b._resize(n);
+	t.resize(2 * n + 2);
+	limb_t *x = t.data(), *y = x + n + 1;
+	const limb_t *ap = a.limbs.data(), *bp = b.limbs.data();
+	x[n] = Nat::_mul_1(x, ap, n, M.v1);
+	x[n] -= Nat::_submul_1(x, bp, n, M.u1);
+	y[n] = Nat::_mul_1(y, bp, n, M.u0);
+	y[n] -= Nat::_submul_1(y, ap, n, M.v0);
+	std::copy(x, x + n, a.limbs.data());
+	std::copy(y, y + n, b.limbs.data());
+	a._contract();
+	b._contract();
+}
+
+/*! (x, y) <- (x, y) M using single limb multiplies */
+static void _row_mul_1(Nat &x, Nat &y, const _matrix1 &M, Nat::limb_vector &t)
+{
+	size_t n = std::max(x.num_limbs(), y.num_limbs());
+	x._resize(n + 1);
+	y._resize(n + 1);
+	t.resize(2 * n + 2);
+	limb_t *u = t.data(), *v = u + n + 1;
+	const limb_t *xp = x.limbs.data(), *yp = y.limbs.data();
+	u[n] = Nat::_mul_1(u, xp, n, M.u0);
+	u[n] += Nat::_addmul_1(u, yp, n, M.v0);
+	v[n] = Nat::_mul_1(v, xp, n, M.u1);
+	v[n] += Nat::_addmul_1(v, yp, n, M.v1);
+	std::copy(u, u + n + 1, x.limbs.data());
+	std::copy(v, v + n + 1, y.limbs.data());
+	x._contract();
+	y._contract();
+}
+
+/*! (x, y) <- (x, y) M */
+static void _row_mul(Nat &x, Nat &y, const _matrix &M)
+{
+	Nat nx = x * M.u0 + y * M.v0;
+	y = x * M.u1 + y * M.v1;
+	x = std::move(nx);
+}
+
+/*! M <- M N */
+static void _matrix_mul_1(_matrix &M, const _matrix1 &N, Nat::limb_vector &t)
+{
+	_row_mul_1(M.u0, M.u1, N, t);
+	_row_mul_1(M.v0, M.v1, N, t);
+}
+
+/*! M <- M N */
+static void _matrix_mul(_matrix &M, const _matrix &N)
+{
+	_row_mul(M.u0, M.u1, N);
+	_row_mul(M.v0, M.v1, N);
+}
+
+/*! (a; b) <- N^-1 (a; b) */
+static void _matrix_apply(const _matrix &N, Nat &a, Nat &b)
+{
+	Nat x = N.v1 * a - N.u1 * b;
+	b = N.u0 * b - N.v0 * a;
+	a = std::move(x);
+}
+
+
+/*----------.
+| half gcd. |
+`----------*/
+
+/*! one Lehmer step keeping a and b at least 2^s, false if none */
+static bool _hgcd_lehmer_step(Nat &a, Nat &b, size_t s, _matrix &M, Nat::limb_vector &t)
+{
+	/* reduced top limbs are above 2^(limb_bits/2) plus the largest entry
+	 * of N, so the reduced a and b are above 2^(n - limb_bits/2) */
+	size_t n = std::max(a.num_bits(), b.num_bits());
+	if (n < s + Nat::limb_bits) return false;
+	_matrix1 N;
+	if (!_hgcd_1(_bits_at(a, n - Nat::limb_bits), _bits_at(b, n - Nat::limb_bits), N)) {
+		return false;
+	}
+	_apply_1(a, b, N, t);
+	_matrix_mul_1(M, N, t);
+	return true;
+}
+
+/*! one division step keeping a and b at least 2^s, false if none */
+static bool _hgcd_div_step(Nat &a, Nat &b, size_t s, _matrix &M)
+{
+	bool swap = a < b;
+	Nat &x = swap ? b : a, &y = swap ? a : b;
+	Nat q, r;
+	Nat::divrem(x, y, q, r);
+	if (r.num_bits() <= s) {
+		if (q == 1) return false;
+		q -= Nat(1);
+		r += y;
+	}
+	x = std::move(r);
+	if (swap) {
+		M.u0 += q * M.u1;
+		M.v0 += q * M.v1;
+	} else {
+		M.u1 += q * M.u0;
+		M.v1 += q * M.v0;
+	}
+	return true;
+}
+
+/*! one reduction step keeping a and b at least 2^s, false if none */
+static bool _hgcd_step(Nat &a, Nat &b, size_t s, _matrix &M, Nat::limb_vector &t)
+{
+	return _hgcd_lehmer_step(a, b, s, M, t) || _hgcd_div_step(a, b, s, M);
+}
+
+/*!
+ * half gcd (Moller). reduces a and b of at most n bits in place while both
+ * stay at least 2^s for s = n/2 + 1, accumulating the cofactor matrix in M
+ * whose entries are then below 2^(n - s). large inputs recurse on the high
+ * halves twice, first on the top n/2 bits, then once single steps have
+ * reduced them to 3n/4 bits, on the top 2(m - s) bits of the m bit values,
+ * with each matrix applied to the full values. if no step is possible
+ * before reaching 3n/4 bits, none is possible at all. returns false if
+ * no step was possible.
+ */
+static bool _hgcd(Nat &a, Nat &b, _matrix &M, Nat::limb_vector &t)
+{
+	size_t n = std::max(a.num_bits(), b.num_bits()), s = n / 2 + 1;
+	bool progress = false;
+	M = _matrix{1, 0, 0, 1};
+	if (a.num_bits() <= s || b.num_bits() <= s) {
+		return false;
+	}
+
+	if (n >= Nat::hgcd_threshold * Nat::limb_bits) {
+		size_t p = n / 2;
+		Nat a1 = a >> p, b1 = b >> p;
+		if (_hgcd(a1, b1, M, t)) {
+			_matrix_apply(M, a, b);
+			progress = true;
+		}
+		size_t n2 = 3 * n / 4 + 1;
+		while (std::max(a.num_bits(), b.num_bits()) > n2) {
+			if (!_hgcd_step(a, b, s, M, t)) return progress;
+			progress = true;
+		}
+		size_t m = std::max(a.num_bits(), b.num_bits());
+		if (m > s + 2) {
+			size_t p2 = 2 * s - m;
+			Nat a2 = a >> p2, b2 = b >> p2;
+			_matrix M2;
+			if (_hgcd(a2, b2, M2, t)) {
+				_matrix_apply(M2, a, b);
+				_matrix_mul(M, M2);
+				progress = true;
+			}
+		}
+	}
+
+	while (_hgcd_step(a, b, s, M, t)) {
+		progress = true;
+	}
+	return progress;
+}
+
+
+/*-------------------------.
+| greatest common divisor. |
+`-------------------------*/
+
+/*!
+ * reduce a and b until one is zero. operands of hgcd_threshold limbs are
+ * reduced by a quarter with the half gcd matrix of their top halves, then
+ * Lehmer steps on the top limb, falling back to a division step when the
+ * quotient does not fit the top limb. if x is non-null the
+ * second row (x, y) of the cofactor matrix is accumulated.
+ */
+static void _gcd_reduce(Nat &a, Nat &b, Nat *x, Nat *y)
+{
+	Nat::limb_vector t;
+	while (a != 0 && b != 0) {
+		size_t n = std::max(a.num_bits(), b.num_bits());
+		if (std::min(a.num_limbs(), b.num_limbs()) >= Nat::hgcd_threshold) {
+			_matrix M;
+			Nat ah = a >> n / 2, bh = b >> n / 2;
+			if (_hgcd(ah, bh, M, t)) {
+				_matrix_apply(M, a, b);
+				if (x) _row_mul(*x, *y, M);
+				continue;
+			}
+		} else if (n >= Nat::limb_bits) {
+			_matrix1 N;
+			if (_hgcd_1(_bits_at(a, n - Nat::limb_bits), _bits_at(b, n - Nat::limb_bits), N)) {
+				_apply_1(a, b, N, t);
+				if (x) _row_mul_1(*x, *y, N, t);
+				continue;
+			}
+		} else if (!x) {
+			limb_t u = a.limbs[0], v = b.limbs[0];
+			while (v) {
+				limb_t r = u % v;
+				u = v;
+				v = r;
+			}
+			a = u;
+			b = 0;
+			break;
+		}
+
+		bool swap = a < b;
+		Nat &u = swap ? b : a, &v = swap ? a : b;
+		Nat q, r;
+		Nat::divrem(u, v, q, r);
+		u = std::move(r);
+		if (x) {
+			if (swap) {
+				*x += q * *y;
+			} else {
+				*y += q * *x;
+			}
+		}
+	}
+}
+
+/*! greatest common divisor */
+Nat gcd(const Nat &a, const Nat &b)
+{
+	Nat u = _var(a), v = _var(b);
+	_gcd_reduce(u, v, nullptr, nullptr);
+	return u == 0 ? v : u;
+}
+
+/*!
+ * the cofactor matrix K with (A; B) = K (a; b) ends with a or b zero. if
+ * b is zero then g = a = K11 A - K01 B, otherwise g = b = K00 B - K10 A.
+ * only the second row of K is tracked, giving s, and t = (A s -+ g) / B.
+ */
+static bool _xgcd(const Nat &A, const Nat &B, Nat &g, Nat &s)
+{
+	Nat a = A, b = B, x(0), y(1);
+	_gcd_reduce(a, b, &x, &y);
+	if (b == 0) {
+		g = std::move(a);
+		s = std::move(y);
+		return true;
+	} else {
+		g = std::move(b);
+		s = std::move(x);
+		return false;
+	}
+}
+
+/*! extended greatest common divisor */
+bool xgcd(const Nat &a, const Nat &b, Nat &g, Nat &s, Nat &t)
+{
+	Nat A = _var(a), B = _var(b);
+	if (B == 0) {
+		s = A == 0 ? 0 : 1;
+		t = 0;
+		g = std::move(A);
+		return true;
+	}
+	if (A == 0) {
+		s = 0;
+		t = 1;
+		g = std::move(B);
+		return false;
+	}
+	bool pos = _xgcd(A, B, g, s);
+	t = pos ? (A * s - g) / B : (A * s + g) / B;
+	return pos;
+}
+
+/*! modular inverse */
+Nat modinv(const Nat &a, const Nat &m)
+{
+	Nat M = _var(m);
+	if (M == 0) {
+		throw std::domain_error("modinv requires a nonzero modulus");
+	}
+	Nat g, s;
+	bool pos = _xgcd(_var(a) % M, M, g, s);
+	if (g != 1) {
+		throw std::domain_error("modinv argument is not invertible");
+	}
+	s = s % M;
+	return pos || s == 0 ? s : M - s;
+}
+
+
+/*---------------.
+| integer roots. |
+`---------------*/
+
+/*!
+ * Newton iteration y' = ((k - 1) y + a / y^(k - 1)) / k for the floor of
+ * the k-th root. started from y at or above the root, the iterates
+ * decrease to the floor of the root and the first that fails to
+ * decrease is the result.
+ */
+static Nat _newton_root(const Nat &a, size_t k, Nat y)
+{
+	for (;;) {
+		Nat d = k == 2 ? a / y : a / y.pow(k - 1);
+		Nat x = k == 2 ? (y + d) >> 1 : (y * Nat(limb_t(k - 1)) + d) / Nat(limb_t(k));
+		if (x >= y) return y;
+		y = std::move(x);
+	}
+}
+
+/*!
+ * the seed for the n bit a is found recursively from the root of its top
+ * half: with r the root of a >> ks for s = n / 2k, (r + 1) << s is above
+ * the root of a and agrees with it in about half of its bits, which one
+ * Newton step doubles. the iteration then costs a few divisions at the
+ * full size. square roots of one limb start from the double precision
+ * root and other small roots from 2^ceil(n / k).
+ */
+static Nat _iroot(const Nat &a, size_t k)
+{
+	size_t n = a.num_bits();
+	if (n == 0) return Nat(0);
+	if (k >= n) return Nat(1);
+	if (k == 2 && n <= Nat::limb_bits) {
+		limb_t v = a.limb_at(0), r = limb_t(std::sqrt(double(v)));
+		while (limb2_t(r) * r > v) r--;
+		while (limb2_t(r + 1) * (r + 1) <= v) r++;
+		return Nat(r);
+	}
+	if (n / k < Nat::limb_bits) {
+		return _newton_root(a, k, Nat(1) << ((n + k - 1) / k));
+	}
+	size_t s = n / (2 * k);
+	return _newton_root(a, k, (_iroot(a >> k * s, k) + Nat(1)) << s);
+}
+
+/*! floor of the square root */
+Nat isqrt(const Nat &a)
+{
+	return _iroot(_var(a), 2);
+}
+
+/*! floor of the k-th root */
+Nat iroot(const Nat &a, size_t k)
+{
+	if (k == 0) {
+		throw std::domain_error("iroot requires a nonzero exponent");
+	}
+	Nat v = _var(a);
+	return k == 1 ? v : _iroot(v, k);
+}
+
+/*! b^e mod q for q below 2^32 */
+static uint64_t _powmod_small(uint64_t b, size_t e, uint64_t q)
+{
+	uint64_t r = 1;
+	for (b %= q; e; e >>= 1) {
+		if (e & 1) r = r * b % q;
+		b = b * b % q;
+	}
+	return r;
+}
+
+/*!
+ * q below 2^32 is prime, by trial division by the primes below 16 and
+ * then Miller-Rabin to the bases 2, 7 and 61, which is exact in this range.
+ */
+static bool _is_small_prime(uint64_t q)
+{
+	for (uint64_t d : { 2, 3, 5, 7, 11, 13 }) {
+		if (q % d == 0) return q == d;
+	}
+	if (q < 256) return q > 1;
+	uint64_t d = q - 1;
+	int s = 0;
+	while ((d & 1) == 0) {
+		d >>= 1;
+		s++;
+	}
+	for (uint64_t b : { 2, 7, 61 }) {
+		uint64_t x = _powmod_small(b, d, q);
+		if (x == 1 || x == q - 1) continue;
+		int i = 1;
+		for (; i < s && x != q - 1; i++) {
+			x = x * x % q;
+		}
+		if (x != q - 1) return false;
+	}
+	return true;
+}
+
+/*! a mod q for a single limb q by Horner's rule */
+static limb_t _mod_1(const Nat &a, limb_t q)
+{
+	limb2_t r = 0;
+	for (size_t i = a.num_limbs(); i-- > 0; ) {
+		r = ((r << Nat::limb_bits) | a.limbs[i]) % q;
+	}
+	return limb_t(r);
+}
+
+/*!
+ * residues of a modulo each of the small q by a remainder tree: a is
+ * reduced modulo the product of all q, then each remainder modulo the
+ * products of the two halves, down to the products of groups of 16 q,
+ * whose remainders are reduced by each q of the group. this costs a few
+ * full size divisions rather than one pass over a for each q.
+ */
+static std::vector<limb_t> _residues(const Nat &a, const std::vector<limb_t> &q)
+{
+	const size_t group = 16;
+	if (q.empty()) return std::vector<limb_t>();
+	std::vector<std::vector<Nat>> tree(1);
+	for (size_t i = 0; i < q.size(); i += group) {
+		Nat x(1);
+		for (size_t j = i; j < std::min(i + group, q.size()); j++) x *= Nat(q[j]);
+		tree[0].push_back(std::move(x));
+	}
+	while (tree.back().size() > 1) {
+		const std::vector<Nat> &lo = tree.back();
+		std::vector<Nat> hi;
+		for (size_t i = 0; i < lo.size(); i += 2) {
+			hi.push_back(i + 1 < lo.size() ? lo[i] * lo[i + 1] : lo[i]);
+		}
+		tree.push_back(std::move(hi));
+	}
+	std::vector<Nat> rem(1, a % tree.back()[0]);
+	for (size_t l = tree.size() - 1; l-- > 0; ) {
+		std::vector<Nat> next;
+		for (size_t i = 0; i < tree[l].size(); i++) {
+			next.push_back(rem[i / 2] % tree[l][i]);
+		}
+		rem = std::move(next);
+	}
+	std::vector<limb_t> r;
+	for (size_t i = 0; i < q.size(); i++) {
+		r.push_back(_mod_1(rem[i / group], q[i]));
+	}
+	return r;
+}
+
+/*! smallest prime q = 1 mod p above q0 */
+static uint64_t _next_residue_prime(uint64_t p, uint64_t q0)
+{
+	uint64_t q = q0 + 2 * p;
+	while (!_is_small_prime(q)) q += 2 * p;
+	return q;
+}
+
+/*! r is zero or a p-th power residue modulo the prime q = 1 mod p */
+static bool _is_power_residue(uint64_t r, uint64_t p, uint64_t q)
+{
+	return r == 0 || _powmod_small(r, (q - 1) / p, q) == 1;
+}
+
+/*!
+ * a is tested for a p-th root for each prime p below its size in bits,
+ * which also covers composite exponents. an exponent must divide the
+ * number of trailing zero bits if there are any. before computing the
+ * root, a is checked to be a p-th power residue modulo primes q = 1 mod
+ * p, where only one in p residues is a p-th power. the first residue
+ * for every exponent comes from one remainder tree and the few exponents
+ * that pass are checked modulo two more primes.
+ */
+bool is_perfect_power(const Nat &a)
+{
+	Nat v = _var(a);
+	size_t n = v.num_bits();
+	if (n <= 1) return true;
+	size_t tz = 0;
+	while (!v.test_bit(tz)) tz++;
+
+	std::vector<limb_t> ps, qs;
+	for (size_t p : _primes_below(n)) {
+		if (tz > 0 && tz % p != 0) continue;
+		ps.push_back(limb_t(p));
+		qs.push_back(limb_t(_next_residue_prime(p, 1)));
+	}
+	std::vector<limb_t> rs = _residues(v, qs);
+	for (size_t i = 0; i < ps.size(); i++) {
+		uint64_t p = ps[i], q = qs[i];
+		bool residue = _is_power_residue(rs[i], p, q);
+		for (int j = 0; residue && j < 2; j++) {
+			q = _next_residue_prime(p, q);
+			residue = _is_power_residue(_mod_1(v, limb_t(q)), p, q);
+		}
+		if (residue && _iroot(v, p).pow(p) == v) return true;
+	}
+	return false;
+}
+
+
+/*-----------.
+| primality. |
+`-----------*/
+
+/*
+ * the odd primes below 2^16 are grouped into products that fit a limb,
+ * each with the reciprocal used by the single limb division kernel. the
+ * residue of n modulo a group then costs one pass over n with multiplies
+ * rather than divisions, and the residues modulo the primes of the group
+ * follow from the single limb remainder.
+ */
+
+/*! odd primes below 2^16 and their single limb products */
+struct _prime_table
+{
+	struct group { Nat::Divisor div; size_t first, last; };
+
+	static const limb_t bound = 65536, trial_bound = 1024;
+
+	std::vector<limb_t> primes;
+	std::vector<group> groups;
+
+	/* groups of the primes below trial_bound, used by is_probable_prime */
+	size_t trial_groups;
+
+	_prime_table();
+};
+
+_prime_table::_prime_table() : trial_groups(0)
+{
+	for (size_t p : _primes_below(bound)) {
+		if (p > 2) primes.push_back(limb_t(p));
+	}
+	for (size_t i = 0; i < primes.size(); ) {
+		size_t first = i;
+		limb_t prod = 1;
+		while (i < primes.size() && (limb2_t(prod) * primes[i]) >> Nat::limb_bits == 0) {
+			prod *= primes[i++];
+		}
+		groups.push_back(group{ Nat::Divisor(Nat(prod)), first, i });
+		if (primes[first] < trial_bound) trial_groups++;
+	}
+}
+
+/*! the table, built on first use */
+static const _prime_table& _small_primes()
+{
+	static const _prime_table table;
+	return table;
+}
+
+/*! n mod the product of a group, with n limbs of scratch in q */
+static limb_t _group_residue(const Nat &n, const _prime_table::group &g, limb_t *q)
+{
+	return Nat::_div_1(q, n.limbs.data(), n.num_limbs(), g.div.d[0], g.div.dinv, g.div.shift);
+}
+
+/*! n above the small primes has a factor below trial_bound */
+static bool _has_small_factor(const Nat &n)
+{
+	const _prime_table &t = _small_primes();
+	Nat::limb_vector q;
+	q.resize(n.num_limbs());
+	for (size_t g = 0; g < t.trial_groups; g++) {
+		limb_t r = _group_residue(n, t.groups[g], q.data());
+		for (size_t i = t.groups[g].first; i < t.groups[g].last; i++) {
+			if (r % t.primes[i] == 0) return true;
+		}
+	}
+	return false;
+}
+
+/*!
+ * strong probable prime test to base a for odd m with m - 1 = d 2^s,
+ * passing if a^d = 1 or a^(d 2^r) = -1 mod m for some r < s. squarings
+ * stay in Montgomery form, where one and minus one are R and m - R.
+ */
+static bool _strong_test(const Nat &a, const Nat &d, size_t s, const MontgomeryContext &ctx)
+{
+	const Nat &m = ctx.m;
+	Nat x = modpow(a, d, ctx);
+	if (x == 1 || x == m - Nat(1)) return true;
+	Nat y = ctx.to_mont(x), one = ctx.to_mont(Nat(1)), mone = m - one;
+	for (size_t r = 1; r < s; r++) {
+		y = ctx.sqr(y);
+		if (y == mone) return true;
+		if (y == one) return false;
+	}
+	return false;
+}
+
+/*! Jacobi symbol (a/n) for odd n */
+static int _jacobi_small(uint64_t a, uint64_t n)
+{
+	int j = 1;
+	a %= n;
+	while (a != 0) {
+		while ((a & 1) == 0) {
+			a >>= 1;
+			if ((n & 7) == 3 || (n & 7) == 5) j = -j;
+		}
+		std::swap(a, n);
+		if ((a & 3) == 3 && (n & 3) == 3) j = -j;
+		a %= n;
+	}
+	return n == 1 ? j : 0;
+}
+
+/*! Jacobi symbol (D/n) for odd D of one limb and odd n, by reciprocity */
+static int _jacobi(long D, const Nat &n)
+{
+	limb_t x = limb_t(D < 0 ? -D : D), n0 = n.limb_at(0);
+	int j = D < 0 && (n0 & 3) == 3 ? -1 : 1;
+	if ((x & 3) == 3 && (n0 & 3) == 3) j = -j;
+	return j * _jacobi_small(_mod_1(n, x), x);
+}
+
+/*! copy a reduced value into n zero padded limbs */
+static void _load(limb_t *r, const Nat &a, size_t n)
+{
+	std::copy(a.limbs.data(), a.limbs.data() + a.num_limbs(), r);
+	std::fill(r + a.num_limbs(), r + n, limb_t(0));
+}
+
+/*! n limbs are zero */
+static bool _is_zero(const limb_t *a, size_t n)
+{
+	return Nat::_cmp(a, n, a, 0) == 0;
+}
+
+/*! r = a + b mod m for n limbs of reduced a and b */
+static void _add_mod(limb_t *r, const limb_t *a, const limb_t *b, const limb_t *m, size_t n)
+{
+	if (Nat::_add_n(r, a, b, n) || Nat::_cmp(r, n, m, n) >= 0) {
+		Nat::_sub_n(r, r, m, n);
+	}
+}
+
+/*! r = a - b mod m for n limbs of reduced a and b */
+static void _sub_mod(limb_t *r, const limb_t *a, const limb_t *b, const limb_t *m, size_t n)
+{
+	if (Nat::_sub_n(r, a, b, n)) {
+		Nat::_add_n(r, r, m, n);
+	}
+}
+
+/*! r = a / 2 mod odd m for n limbs of reduced a */
+static void _half_mod(limb_t *r, const limb_t *a, const limb_t *m, size_t n)
+{
+	limb_t c = 0;
+	if (a[0] & 1) {
+		c = Nat::_add_n(r, a, m, n);
+	} else {
+		std::copy(a, a + n, r);
+	}
+	for (size_t i = 0; i < n; i++) {
+		limb_t hi = i + 1 < n ? r[i + 1] : c;
+		r[i] = (r[i] >> 1) | (hi << (Nat::limb_bits - 1));
+	}
+}
+
+/*! D mod m for small signed D */
+static Nat _signed_mod(long D, const Nat &m)
+{
+	return D < 0 ? m - Nat(limb_t(-D)) : Nat(limb_t(D));
+}
+
+/*!
+ * strong Lucas probable prime test with Selfridge's parameters: D is the
+ * first of 5, -7, 9, -11, ... with (D/m) = -1, P = 1 and Q = (1 - D)/4.
+ * with m + 1 = d 2^s for odd d, m passes if U_d = 0 or V_(d 2^r) = 0 for
+ * some r < s. the binary method on the bits of d doubles the index with
+ * U_2k = U_k V_k, V_2k = V_k^2 - 2Q^k and steps it with U_k+1 =
+ * (U_k + V_k)/2, V_k+1 = (D U_k + V_k)/2, using the Montgomery kernels.
+ */
+static bool _lucas_test(const MontgomeryContext &ctx)
+{
+	const Nat &m = ctx.m;
+	long D = 5;
+	for (int i = 0; ; i++) {
+		int j = _jacobi(D, m);
+		if (j == -1) break;
+		if (j == 0) return false;
+		/* there is no such D for squares */
+		if (i == 4 && isqrt(m).pow(2) == m) return false;
+		D = D > 0 ? -(D + 2) : -D + 2;
+	}
+	Nat d = m + Nat(1);
+	size_t s = 0;
+	while (!d.test_bit(s)) s++;
+	d >>= s;
+
+	size_t n = ctx.n;
+	Nat::limb_vector buf;
+	buf.resize(7 * n + ctx._scratch());
+	limb_t *U = buf.data(), *V = U + n, *Qk = V + n, *Dm = Qk + n, *Qm = Dm + n;
+	limb_t *x = Qm + n, *y = x + n, *t = y + n;
+	const limb_t *mp = m.limbs.data();
+	_load(U, ctx.to_mont(Nat(1)), n);
+	_load(V, ctx.to_mont(Nat(1)), n);
+	_load(Dm, ctx.to_mont(_signed_mod(D, m)), n);
+	_load(Qm, ctx.to_mont(_signed_mod((1 - D) / 4, m)), n);
+	std::copy(Qm, Qm + n, Qk);
+
+	for (size_t i = d.num_bits() - 1; i-- > 0; ) {
+		ctx._mul(U, U, V, t);
+		ctx._sqr(V, V, t);
+		_add_mod(x, Qk, Qk, mp, n);
+		_sub_mod(V, V, x, mp, n);
+		ctx._sqr(Qk, Qk, t);
+		if (d.test_bit(i)) {
+			ctx._mul(x, Dm, U, t);
+			_add_mod(y, U, V, mp, n);
+			_half_mod(U, y, mp, n);
+			_add_mod(x, x, V, mp, n);
+			_half_mod(V, x, mp, n);
+			ctx._mul(Qk, Qk, Qm, t);
+		}
+	}
+	if (_is_zero(U, n) || _is_zero(V, n)) return true;
+	for (size_t r = 1; r < s; r++) {
+		ctx._sqr(V, V, t);
+		_add_mod(x, Qk, Qk, mp, n);
+		_sub_mod(V, V, x, mp, n);
+		if (_is_zero(V, n)) return true;
+		ctx._sqr(Qk, Qk, t);
+	}
+	return false;
+}
+
+/*!
+ * tests after trial division for odd m above 2^32: base 2, then rounds
+ * bases from a generator seeded by m, then the Lucas test if requested
+ */
+static bool _probable_prime(const Nat &m, size_t rounds, bool lucas)
+{
+	MontgomeryContext ctx(m);
+	Nat d = m - Nat(1);
+	size_t s = 0;
+	while (!d.test_bit(s)) s++;
+	d >>= s;
+	if (!_strong_test(Nat(2), d, s, ctx)) return false;
+
+	uint64_t state = uint64_t(m.limb_at(0)) ^ 0x2545f4914f6cdd1dULL;
+	for (size_t i = 0; i < rounds; i++) {
+		Nat a;
+		a._resize(m.num_limbs());
+		for (size_t j = 0; j < m.num_limbs(); j++) {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			a.limbs[j] = limb_t(state);
+		}
+		a._contract();
+		a = a % (m - Nat(3)) + Nat(2);
+		if (!_strong_test(a, d, s, ctx)) return false;
+	}
+	return !lucas || _lucas_test(ctx);
+}
+
+/*! probable prime test */
+bool is_probable_prime(const Nat &n, size_t rounds, bool lucas)
+{
+	Nat m = _var(n);
+	if (m.num_bits() <= 32) return _is_small_prime(m.limb_at(0));
+	if (!m.test_bit(0) || _has_small_factor(m)) return false;
+	return _probable_prime(m, rounds, lucas);
+}
+
+/*!
+ * candidates above 2^32 are sieved in windows of odd numbers. the
+ * residues of the window start modulo the small primes mark their
+ * multiples in the window, then advance by the window width, so only
+ * about one in twenty candidates reaches the probable prime test.
+ */
+Nat next_prime(const Nat &n)
+{
+	Nat m = _var(n) + Nat(1);
+	if (m.num_bits() <= 32) {
+		for (uint64_t x = m.limb_at(0); x < (uint64_t(1) << 32); x++) {
+			if (_is_small_prime(x)) return Nat(limb_t(x));
+		}
+		m = Nat(1) << 32;
+	}
+	if (!m.test_bit(0)) m += Nat(1);
+
+	const _prime_table &t = _small_primes();
+	const size_t window = 4096;
+	std::vector<limb_t> r(t.primes.size());
+	Nat::limb_vector q;
+	q.resize(m.num_limbs());
+	for (const _prime_table::group &g : t.groups) {
+		limb_t rg = _group_residue(m, g, q.data());
+		for (size_t i = g.first; i < g.last; i++) r[i] = rg % t.primes[i];
+	}
+
+	std::vector<bool> sieve(window);
+	for (;; m += Nat(limb_t(2 * window))) {
+		std::fill(sieve.begin(), sieve.end(), false);
+		for (size_t i = 0; i < t.primes.size(); i++) {
+			/* m + 2j = 0 mod p for j = -r/2 = (p - r)(p + 1)/2 mod p */
+			uint64_t p = t.primes[i];
+			size_t j = size_t((p - r[i]) * ((p + 1) / 2) % p);
+			for (; j < window; j += p) sieve[j] = true;
+			r[i] = limb_t((r[i] + 2 * window) % p);
+		}
+		for (size_t j = 0; j < window; j++) {
+			if (sieve[j]) continue;
+			Nat c = m + Nat(limb_t(2 * j));
+			if (_probable_prime(c, 0, true)) return c;
+		}
+	}
+}
+
+
+/*----------.
+| products. |
+`----------*/
+
+/*! product of v by a balanced product tree */
+Nat product(std::vector<Nat> v)
+{
+	if (v.empty()) return Nat(1);
+	while (v.size() > 1) {
+		size_t h = 0;
+		for (size_t i = 0; i + 1 < v.size(); i += 2) {
+			v[h++] = v[i] * v[i + 1];
+		}
+		if (v.size() & 1) {
+			v[h++] = std::move(v.back());
+		}
+		v.resize(h);
+	}
+	return _var(v[0]);
+}
+
+/*! Nat from a 64-bit value */
+static Nat _from_u64(uint64_t x)
+{
+	Nat r;
+	for (size_t s = 0; s < 64; s += Nat::limb_bits) {
+		r |= Nat(limb_t(x >> s)) << s;
+	}
+	return r;
+}
+
+/*!
+ * factors of a product. small factors are multiplied together into single
+ * limbs, so the product tree starts from full limbs rather than from
+ * many small values.
+ */
+struct _factors
+{
+	std::vector<Nat> v;
+	limb_t acc = 1;
+
+	void push(uint64_t x)
+	{
+		if ((x >> (Nat::limb_bits - 1) >> 1) != 0) {
+			v.push_back(_from_u64(x));
+		} else if ((limb2_t(acc) * x) >> Nat::limb_bits == 0) {
+			acc *= limb_t(x);
+		} else {
+			v.push_back(Nat(acc));
+			acc = limb_t(x);
+		}
+	}
+
+	Nat product()
+	{
+		v.push_back(Nat(acc));
+		acc = 1;
+		return ::product(std::move(v));
+	}
+};
+
+/*!
+ * n! is 2^(n - popcount(n)) times the product over k >= 0 of the odd
+ * numbers up to n >> k. the odd numbers in (n >> (k + 1), n >> k] are in
+ * k + 1 of these, so with P_k their product from a product tree, the odd
+ * part is the product over k of the running products P_top ... P_k.
+ */
+Nat factorial(size_t n)
+{
+	size_t bits = 0, ones = 0;
+	for (size_t x = n; x; x >>= 1) {
+		bits++;
+		ones += x & 1;
+	}
+	Nat r(1), t(1);
+	for (size_t k = bits; k-- > 0; ) {
+		size_t hi = n >> k, lo = n >> (k + 1);
+		_factors f;
+		for (size_t x = (lo + 1) | 1; x <= hi; x += 2) {
+			f.push(x);
+		}
+		t *= f.product();
+		r *= t;
+	}
+	return r << (n - ones);
+}
+
+/*!
+ * when k is small against n the result is the product of n - k + 1 ... n
+ * divided by k!. otherwise the exponent of each prime p up to n is the
+ * number of carries adding k and n - k in base p (Kummer), counted from
+ * floor(n / p^i) - floor(k / p^i) - floor((n - k) / p^i), and the prime
+ * powers are multiplied in a product tree, so no intermediate value is
+ * larger than the result.
+ */
+Nat binomial(size_t n, size_t k)
+{
+	if (k > n) return Nat(0);
+	k = std::min(k, n - k);
+	_factors f;
+	if (k < n / 32) {
+		for (size_t i = 0; i < k; i++) {
+			f.push(n - i);
+		}
+		return f.product() / factorial(k);
+	}
+	for (size_t p : _primes_below(n + 1)) {
+		for (size_t q = p; ; q *= p) {
+			for (size_t e = n / q - k / q - (n - k) / q; e > 0; e--) {
+				f.push(p);
+			}
+			if (q > n / p) break;
+		}
+	}
+	return f.product();
+}
+
+/*! product of the primes up to n */
+Nat primorial(size_t n)
+{
+	_factors f;
+	for (size_t p : _primes_below(n + 1)) {
+		f.push(p);
+	}
+	return f.product();
+}
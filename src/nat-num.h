@@ -0,0 +1,113 @@
+/*
+ * nat-num.h
+ *
+ * number theoretic functions for natural numbers
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "nat.h"
+
+/*
+ * number theoretic functions take and return variable width unsigned
+ * Nat values. fixed width operands are read by value and the results
+ * are variable width.
+ */
+
+
+/*-------------------------.
+| greatest common divisor. |
+`-------------------------*/
+
+/*! greatest common divisor, gcd(0, 0) is 0 */
+Nat gcd(const Nat &a, const Nat &b);
+
+/*!
+ * extended greatest common divisor. g = gcd(a, b) and s, t hold the
+ * magnitudes of the Bezout coefficients, whose signs alternate. returns
+ * true if a*s - b*t == g and false if b*t - a*s == g. for a, b > 0 the
+ * coefficients satisfy s <= b/g and t <= a/g.
+ */
+bool xgcd(const Nat &a, const Nat &b, Nat &g, Nat &s, Nat &t);
+
+/*! inverse of a modulo m, throws std::domain_error if gcd(a, m) != 1 */
+Nat modinv(const Nat &a, const Nat &m);
+
+
+/*---------------.
+| integer roots. |
+`---------------*/
+
+/*! floor of the square root */
+Nat isqrt(const Nat &a);
+
+/*! floor of the k-th root, throws std::domain_error if k is zero */
+Nat iroot(const Nat &a, size_t k);
+
+/*! true if a == b^k for some b and k >= 2, including 0 and 1 */
+bool is_perfect_power(const Nat &a);
+
+
+/*-----------.
+| primality. |
+`-----------*/
+
+/*!
+ * probable prime test. trial division by the small primes is followed by
+ * a strong probable prime test to base 2 and rounds further Miller-Rabin
+ * tests to pseudo-random bases, with modpow in Montgomery form. if lucas
+ * is set a strong Lucas test completes the Baillie-PSW test, which has no
+ * known counterexample and is exact below 2^64.
+ */
+bool is_probable_prime(const Nat &n, size_t rounds = 0, bool lucas = true);
+
+/*! smallest probable prime above n, using Baillie-PSW */
+Nat next_prime(const Nat &n);
+
+
+/*----------.
+| products. |
+`----------*/
+
+/*!
+ * product of v by a balanced product tree, multiplying neighbours in
+ * pairs so that operands of each multiplication have similar sizes.
+ * the empty product is 1.
+ */
+Nat product(std::vector<Nat> v);
+
+/*! product of the values in [first, last) by a balanced product tree */
+template <typename InputIt>
+Nat product(InputIt first, InputIt last)
+{
+	return product(std::vector<Nat>(first, last));
+}
+
+/*! n! */
+Nat factorial(size_t n);
+
+/*! n choose k, zero if k > n */
+Nat binomial(size_t n, size_t k);
+
+/*! product of the primes up to n */
+Nat primorial(size_t n);
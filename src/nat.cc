@@ -25,14 +25,35 @@
  */
 
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <memory>
+#include <mutex>
 
 #include "nat.h"
 
+#ifndef NAT_X86_SIMD
+#if defined(__GNUC__) && defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define NAT_X86_SIMD 1
+#else
+#define NAT_X86_SIMD 0
+#endif
+#endif
+
+#if NAT_X86_SIMD
+#include <immintrin.h>
+#endif
+
 using limb_t = Nat::limb_t;
 using limb2_t = Nat::limb2_t;
 
 #if defined (__GNUC__)
-#define clz __builtin_clz
+inline static int clz(limb_t val)
+{
+	return Nat::limb_bits == 64 ? __builtin_clzll(val) : __builtin_clz((unsigned)val);
+}
 #elif defined (_MSC_VER)
 #include <intrin.h>
 inline static unsigned long clz(unsigned int val)
@@ -44,9 +65,33 @@ inline static unsigned long clz(unsigned int val)
 #error clz not defined
 #endif
 
+/*! shift right by limb_bits - s, yielding zero when s is zero */
+inline static limb_t shr_comp(limb_t val, int s)
+{
+	return s ? val >> (Nat::limb_bits - s) : 0;
+}
+
+/*! shift left by limb_bits - s, yielding zero when s is zero */
+inline static limb_t shl_comp(limb_t val, int s)
+{
+	return s ? val << (Nat::limb_bits - s) : 0;
+}
+
 const Nat::signedness Nat::_unsigned = { false };  /* unsigned */
 const Nat::signedness Nat::_signed   = { true };   /* signed two's complement */
 
+size_t Nat::karatsuba_threshold = 32;
+size_t Nat::karatsuba_sqr_threshold = 48;
+size_t Nat::toom3_threshold = 256;
+size_t Nat::toom4_threshold = 512;
+size_t Nat::ntt_threshold = limb_bits == 64 ? 4096 : 3072; /* NTT splits 64-bit limbs */
+size_t Nat::bz_threshold = 32;
+size_t Nat::newton_threshold = limb_bits == 64 ? 262144 : 98304; /* one-shot, reuse wins far earlier */
+size_t Nat::hgcd_threshold = 512;
+size_t Nat::from_string_threshold = 32;
+size_t Nat::power_cache_limit = size_t(1) << 20;
+int Nat::simd_level = 2;
+
 
 /*--------------.
 | constructors. |
@@ -99,7 +144,7 @@ Nat::Nat(const Nat &operand)
 }
 
 /*! move constructor  */
-Nat::Nat(const Nat&& operand) noexcept
+Nat::Nat(Nat&& operand) noexcept
 	: limbs(std::move(operand.limbs)), s(operand.s), bits(operand.bits)
 {
 	_contract();
@@ -129,7 +174,7 @@ Nat& Nat::operator=(const Nat &operand)
 }
 
 /*! Nat move assignment operator */
-Nat& Nat::operator=(Nat &&operand)
+Nat& Nat::operator=(Nat &&operand) noexcept
 {
 	limbs = std::move(operand.limbs);
 	bits = operand.bits;
@@ -138,6 +183,111 @@ Nat& Nat::operator=(Nat &&operand)
 }
 
 
+/*--------------.
+| limb storage. |
+`--------------*/
+
+static thread_local Nat::limb_pool *_current_pool = nullptr;
+
+/*! bucket index of the largest power of two not above n */
+static inline size_t _pool_floor_log2(size_t n)
+{
+	size_t b = 0;
+	while (n >>= 1) b++;
+	return b;
+}
+
+/*! allocate heap limbs from the thread's pool or malloc, may round up cap */
+limb_t* Nat::limb_vector::_alloc(size_t &cap)
+{
+	if (_current_pool) {
+		return _current_pool->acquire(cap);
+	}
+	limb_t *p = static_cast<limb_t*>(std::malloc(cap * sizeof(limb_t)));
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+/*! free heap limbs to the thread's pool or free */
+void Nat::limb_vector::_free(limb_t *p, size_t cap)
+{
+	if (!_current_pool || !_current_pool->release(p, cap)) {
+		std::free(p);
+	}
+}
+
+Nat::limb_pool::limb_pool(size_t max_blocks)
+	: free_list(), count(), max_blocks(max_blocks), hits(0), misses(0) {}
+
+Nat::limb_pool::~limb_pool()
+{
+	clear();
+}
+
+/*! return a block of at least cap limbs, cap is rounded up */
+limb_t* Nat::limb_pool::acquire(size_t &cap)
+{
+	/* blocks hold the free list link so must fit a pointer */
+	const size_t min_limbs = (sizeof(limb_t*) + sizeof(limb_t) - 1) / sizeof(limb_t);
+	size_t n = std::max(cap, min_limbs);
+	size_t b = _pool_floor_log2(n);
+	if (n & (n - 1)) b++;
+	cap = size_t(1) << b;
+
+	limb_t *p = free_list[b];
+	if (p) {
+		memcpy(&free_list[b], p, sizeof(limb_t*));
+		count[b]--;
+		hits++;
+		return p;
+	}
+	misses++;
+	p = static_cast<limb_t*>(std::malloc(cap * sizeof(limb_t)));
+	if (!p) throw std::bad_alloc();
+	return p;
+}
+
+/*! keep a block for reuse, false if the bucket is full */
+bool Nat::limb_pool::release(limb_t *p, size_t cap)
+{
+	if (cap * sizeof(limb_t) < sizeof(limb_t*)) return false;
+	size_t b = _pool_floor_log2(cap);
+	if (count[b] >= max_blocks) return false;
+	memcpy(p, &free_list[b], sizeof(limb_t*));
+	free_list[b] = p;
+	count[b]++;
+	return true;
+}
+
+/*! free all cached blocks */
+void Nat::limb_pool::clear()
+{
+	for (size_t b = 0; b < num_buckets; b++) {
+		while (limb_t *p = free_list[b]) {
+			memcpy(&free_list[b], p, sizeof(limb_t*));
+			std::free(p);
+		}
+		count[b] = 0;
+	}
+}
+
+Nat::pool_scope::pool_scope(limb_pool &pool) : prev(_current_pool)
+{
+	_current_pool = &pool;
+}
+
+Nat::pool_scope::~pool_scope()
+{
+	_current_pool = prev;
+}
+
+/*! pool active on the current thread or nullptr */
+Nat::limb_pool* Nat::pool_scope::current()
+{
+	return _current_pool;
+}
+
+
 /*------------------.
 | internal methods. |
 `------------------*/
@@ -154,12 +304,12 @@ void Nat::_contract()
 	while (bits > 0 && num_limbs() > max_limbs()) {
 		limbs.pop_back();
 	}
-	while(num_limbs() > 1 && limbs.back() == 0) {
-		limbs.pop_back();
-	}
 	if (bits > 0 && num_limbs() == max_limbs()) {
 		limbs.back() &= limb_mask(num_limbs() - 1);
 	}
+	while(num_limbs() > 1 && limbs.back() == 0) {
+		limbs.pop_back();
+	}
 }
 
 /*! resize number of limbs */
@@ -188,7 +338,7 @@ limb_t Nat::limb_mask(size_t n) const
     if (bits == 0) return -1;
     if (n < (bits >> limb_shift)) return -1;
     if (n > (bits >> limb_shift)) return 0;
-	else return ((1 << (bits & ((1ULL << limb_bits) - 1))) - 1);
+	else return (limb_t(1) << (bits & (limb_bits - 1))) - 1;
 }
 
 /*! test bit at bit offset */
@@ -204,7 +354,7 @@ void Nat::set_bit(size_t n)
 {
 	size_t word = n >> limb_shift;
 	if (word >= num_limbs()) _resize(word + 1);
-	limbs[word] |= (1ULL << (n & (limb_bits-1)));
+	limbs[word] |= (limb_t(1) << (n & (limb_bits-1)));
 }
 
 /*! return number of bits */
@@ -235,11 +385,12 @@ Nat& Nat::operator+=(const Nat &operand)
 		limb_t old_val = limbs[i];
 		limb_t new_val = old_val + operand.limb_at(i) + carry;
 		limbs[i] = new_val;
-		carry = new_val < old_val;
+		carry = new_val < old_val || (new_val == old_val && carry);
 	}
 	if (carry && num_limbs() < max_limbs()) {
 		limbs.push_back(1);
 	}
+	_contract();
 	return *this;
 }
 
@@ -252,7 +403,11 @@ Nat& Nat::operator-=(const Nat &operand)
 		limb_t old_val = limbs[i];
 		limb_t new_val = old_val - operand.limb_at(i) - borrow;
 		limbs[i] = new_val;
-		borrow = new_val > old_val;
+		borrow = new_val > old_val || (new_val == old_val && borrow);
+	}
+	if (borrow && bits > 0) {
+		/* fixed width wraps around, borrowing from the limbs above */
+		limbs.resize(max_limbs(), limb_t(-1));
 	}
 	_contract();
 	return *this;
@@ -286,6 +441,8 @@ Nat& Nat::operator<<=(size_t shamt)
 /*! right shift equals */
 Nat& Nat::operator>>=(size_t shamt)
 {
+	bool sign = sign_bit();
+	size_t fill = shamt < bits ? bits - shamt : 0;
 	size_t limb_shamt = shamt >> limb_shift;
 	if (limb_shamt > 0) {
 		limbs.erase(limbs.begin(), limbs.begin() + std::min(num_limbs(), limb_shamt));
@@ -294,14 +451,24 @@ Nat& Nat::operator>>=(size_t shamt)
 	if (num_limbs() == 0) {
 		*this = 0;
 	}
-	if (!shamt) return *this;
+	if (shamt) {
+		limb_t carry = 0;
+		for (size_t j = num_limbs(); j > 0; j--) {
+			limb_t old_val = limbs[j - 1];
+			limb_t new_val = (old_val >> shamt) | carry;
+			limbs[j - 1] = new_val;
+			carry = old_val << (limb_bits - shamt);
+		}
+	}
 
-	limb_t carry = -(s.is_signed && sign_bit()) << (shamt-1);
-	for (size_t j = num_limbs(); j > 0; j--) {
-		limb_t old_val = limbs[j - 1];
-		limb_t new_val = (old_val >> shamt) | carry;
-		limbs[j - 1] = new_val;
-		carry = old_val << (limb_bits - shamt);
+	/* signed shift fills the vacated bits from fill to bits with ones */
+	if (sign && fill < bits) {
+		_resize(max_limbs());
+		size_t w = fill >> limb_shift;
+		limbs[w] |= limb_t(-1) << (fill & (limb_bits - 1));
+		for (w++; w < num_limbs(); w++) {
+			limbs[w] = limb_t(-1);
+		}
 	}
 	_contract();
 	return *this;
@@ -400,9 +567,13 @@ Nat Nat::operator^(const Nat &operand) const
 Nat Nat::operator~() const
 {
 	Nat result(*this);
+	if (bits > 0) {
+		result._resize(max_limbs());
+	}
 	for (auto &n : result.limbs) {
 		n = ~n;
 	}
+	result._contract();
 	return result;
 }
 
@@ -448,9 +619,8 @@ bool Nat::operator<(const Nat &operand) const
 		bool sign = sign_bit();
 		if (sign ^ operand.sign_bit()) {
 			return sign;
-		} else if (sign) {
-			return operand < *this;
 		}
+		/* same sign: two's complement order matches unsigned order */
 	}
 
 	/* unsigned comparison */
@@ -482,342 +652,2299 @@ bool Nat::operator!() const { return *this == 0; }
 
 
 /*--------------------.
-| multply and divide. |
+| limb array kernels. |
 `--------------------*/
 
-/* These routines are derived from Hacker's Delight */
+/*! compare limb arrays, ignoring zero big end limbs */
+int Nat::_cmp(const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+	while (an > 0 && a[an - 1] == 0) an--;
+	while (bn > 0 && b[bn - 1] == 0) bn--;
+	if (an != bn) return an < bn ? -1 : 1;
+	for (size_t i = an; i > 0; i--) {
+		if (a[i - 1] != b[i - 1]) return a[i - 1] < b[i - 1] ? -1 : 1;
+	}
+	return 0;
+}
 
-/*! base 2^limb_bits multiply */
-void Nat::mult(const Nat &multiplicand, const Nat multiplier, Nat &result)
+/*! add equal length limb arrays returning carry */
+limb_t Nat::_add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
 {
-	size_t m = multiplicand.num_limbs(), n = multiplier.num_limbs();
-	size_t k = std::min(multiplicand.max_limbs(), m + n);
-	result._resize(k);
 	limb_t carry = 0;
-	limb2_t mj = multiplier.limbs[0];
-	for (size_t i = 0; i < m && i < k; i++) {
-		limb2_t t = limb2_t(multiplicand.limbs[i]) * mj + carry;
-		result.limbs[i] = limb_t(t);
-		carry = t >> limb_bits;
+	for (size_t i = 0; i < n; i++) {
+		limb_t s = a[i] + carry;
+		carry = s < carry;
+		limb_t t = s + b[i];
+		carry += t < s;
+		r[i] = t;
 	}
-	if (m < k) {
-		result.limbs[m] = carry;
+	return carry;
+}
+
+/*! subtract equal length limb arrays returning borrow */
+limb_t Nat::_sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n)
+{
+	limb_t borrow = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb_t x = a[i], d = x - b[i];
+		limb_t t = d - borrow;
+		borrow = (d > x) | (t > d);
+		r[i] = t;
 	}
-	for (size_t j = 1; j < n; j++) {
-		carry = 0;
-		mj = multiplier.limbs[j];
-		for (size_t i = 0; i < m && i + j < k; i++) {
-			limb2_t t = limb2_t(multiplicand.limbs[i]) * mj + limb2_t(result.limbs[i + j]) + carry;
-			result.limbs[i + j] = limb_t(t);
-			carry = t >> limb_bits;
-		}
-		if (j + m < k) {
-			result.limbs[j + m] = carry;
-		}
+	return borrow;
+}
+
+/*! add limb arrays (an >= bn) returning carry */
+limb_t Nat::_add(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+	limb_t carry = _add_n(r, a, b, bn);
+	for (size_t i = bn; i < an; i++) {
+		limb_t s = a[i] + carry;
+		carry = s < carry;
+		r[i] = s;
 	}
-	result._contract();
+	return carry;
 }
 
-/*! base 2^limb_bits division */
-void Nat::divrem(const Nat &dividend, const Nat &divisor, Nat &quotient, Nat &remainder)
+/*! subtract limb arrays (an >= bn) returning borrow */
+limb_t Nat::_sub(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
 {
-	quotient = 0;
-	remainder = 0;
-	ptrdiff_t m = dividend.num_limbs(), n = divisor.num_limbs();
-	quotient._resize(std::max(m - n + 1, ptrdiff_t(1)));
-	remainder._resize(n);
-	limb_t *q = quotient.limbs.data(), *r = remainder.limbs.data();
-	const limb_t *u = dividend.limbs.data(), *v = divisor.limbs.data();
+	limb_t borrow = _sub_n(r, a, b, bn);
+	for (size_t i = bn; i < an; i++) {
+		limb_t x = a[i];
+		r[i] = x - borrow;
+		borrow = x < borrow;
+	}
+	return borrow;
+}
 
-	const limb2_t b = (1ULL << limb_bits); // Number base
-	limb_t *un, *vn;                       // Normalized form of u, v.
-	limb2_t qhat;                          // Estimated quotient digit.
-	limb2_t rhat;                          // A remainder.
+/*! absolute difference (an >= bn) into an limbs, true if b > a */
+bool Nat::_abs_sub(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+	if (_cmp(a, an, b, bn) >= 0) {
+		_sub(r, a, an, b, bn);
+		return false;
+	}
+	/* b > a implies the limbs of a above bn are zero */
+	_sub_n(r, b, a, bn);
+	std::fill(r + bn, r + an, 0);
+	return true;
+}
 
-	if (m < n || n <= 0 || v[n-1] == 0) {
-		quotient = 0;
-		remainder = dividend;
-		return;
+/*! add limb to limb array returning carry */
+limb_t Nat::_add_1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+	for (size_t i = 0; i < n; i++) {
+		limb_t s = a[i] + b;
+		b = s < b;
+		r[i] = s;
 	}
+	return b;
+}
 
-	// Single digit divisor
-	if (n == 1) {
-		limb2_t k = 0;
-		for (ptrdiff_t j = m - 1; j >= 0; j--) {
-			q[j] = limb_t((k*b + u[j]) / v[0]);
-			k = (k*b + u[j]) - q[j]*v[0];
-		}
-		r[0] = limb_t(k);
-		quotient._contract();
-		remainder._contract();
-		return;
+/*! subtract limb from limb array returning borrow */
+limb_t Nat::_sub_1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+	for (size_t i = 0; i < n; i++) {
+		limb_t x = a[i];
+		r[i] = x - b;
+		b = x < b;
 	}
+	return b;
+}
 
-	// Normalize by shifting v left just enough so that
-	// its high-order bit is on, and shift u left the
-	// same amount. We may have to append a high-order
-	// digit on the dividend; we do that unconditionally.
+/*! multiply limb array by limb returning carry */
+limb_t Nat::_mul_1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb2_t t = limb2_t(a[i]) * b + carry;
+		r[i] = limb_t(t);
+		carry = limb_t(t >> limb_bits);
+	}
+	return carry;
+}
 
-	int s = clz(v[n-1]); // 0 <= s <= limb_bits.
-	vn = (limb_t *)alloca(sizeof(limb_t) * n);
-	for (ptrdiff_t i = n - 1; i > 0; i--) {
-		vn[i] = (v[i] << s) | (v[i-1] >> (limb_bits-s));
+/*! multiply limb array by limb and accumulate returning carry */
+limb_t Nat::_addmul_1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+	limb_t carry = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb2_t t = limb2_t(a[i]) * b + r[i] + carry;
+		r[i] = limb_t(t);
+		carry = limb_t(t >> limb_bits);
 	}
-	vn[0] = v[0] << s;
+	return carry;
+}
 
-	un = (limb_t *)alloca(sizeof(limb_t) * (m + 1));
-	un[m] = u[m-1] >> (limb_bits-s);
-	for (ptrdiff_t i = m - 1; i > 0; i--) {
-		un[i] = (u[i] << s) | (u[i-1] >> (limb_bits-s));
+/*! multiply limb array by limb and subtract returning borrow */
+limb_t Nat::_submul_1(limb_t *r, const limb_t *a, size_t n, limb_t b)
+{
+	limb_t borrow = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb2_t t = limb2_t(a[i]) * b + borrow;
+		limb_t x = r[i], lo = limb_t(t);
+		r[i] = x - lo;
+		borrow = limb_t(t >> limb_bits) + (x < lo);
 	}
-	un[0] = u[0] << s;
-	for (ptrdiff_t j = m - n; j >= 0; j--) { // Main loop.
-		// Compute estimate qhat of q[j].
-		qhat = (un[j+n]*b + un[j+n-1]) / vn[n-1];
-		rhat = (un[j+n]*b + un[j+n-1]) - qhat * vn[n-1];
-	again:
-		if (qhat >= b || qhat*vn[n-2] > b*rhat + un[j+n-2]) {
-			qhat = qhat - 1;
-			rhat = rhat + vn[n-1];
-			if (rhat < b) goto again;
-		}
-		// Multiply and subtract.
-		limb2_t k = 0;
-		slimb2_t t = 0;
-		for (ptrdiff_t i = 0; i < n; i++) {
-			unsigned long long p = qhat*vn[i];
-			t = un[i+j] - k - (p & ((1ULL<<limb_bits)-1));
-			un[i+j] = limb_t(t);
-			k = (p >> limb_bits) - (t >> limb_bits);
-		}
-		t = un[j+n] - k;
-		un[j+n] = limb_t(t);
-
-		q[j] = limb_t(qhat); // Store quotient digit.
-		if (t < 0) {         // If we subtracted too
-			q[j] = q[j] - 1; // much, add back.
-			k = 0;
-			for (ptrdiff_t i = 0; i < n; i++) {
-				t = un[i+j] + vn[i] + k;
-				un[i+j] = limb_t(t);
-				k = t >> limb_bits;
-			}
-			un[j+n] = limb_t(un[j+n] + k);
-		}
+	return borrow;
+}
+
+/*! schoolbook multiply into an + bn limbs */
+void Nat::_mul_basecase(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
+{
+	r[an] = _mul_1(r, a, an, b[0]);
+	for (size_t j = 1; j < bn; j++) {
+		r[an + j] = _addmul_1(r + j, a, an, b[j]);
 	}
+}
 
-	// normalize remainder
-	for (ptrdiff_t i = 0; i < n; i++) {
-		r[i] = (un[i] >> s) | (un[i + 1] << (limb_bits - s));
+/*
+ * karatsuba multiply (an >= bn > (an + 1) / 2) into an + bn limbs
+ *
+ * splits a = a1 * B^h + a0 and b = b1 * B^h + b0 and uses the subtractive
+ * form a0*b1 + a1*b0 = a0*b0 + a1*b1 - (a0 - a1) * (b0 - b1) so that the
+ * middle product never exceeds h limbs per operand.
+ *
+ * scratch layout: t[2h] | da[h] db[h] | 1 | recursion
+ */
+void Nat::_mul_karatsuba(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *ws)
+{
+	size_t h = (an + 1) >> 1, rn = an + bn;
+	limb_t *t = ws, *da = ws + 2 * h, *db = ws + 3 * h, *mid = da;
+	limb_t *ws2 = ws + 4 * h + 1;
+
+	bool sa = _abs_sub(da, a, h, a + h, an - h);
+	bool sb = _abs_sub(db, b, h, b + h, bn - h);
+	_mul(t, da, h, db, h, ws2);
+	_mul(r, a, h, b, h, ws2);
+	_mul(r + 2 * h, a + h, an - h, b + h, bn - h, ws2);
+
+	/* mid = z0 + z2 -/+ |a0 - a1| * |b0 - b1| */
+	mid[2 * h] = _add(mid, r, 2 * h, r + 2 * h, rn - 2 * h);
+	if (sa == sb) {
+		mid[2 * h] -= _sub_n(mid, mid, t, 2 * h);
+	} else {
+		mid[2 * h] += _add_n(mid, mid, t, 2 * h);
 	}
 
-	quotient._contract();
-	remainder._contract();
+	/* add mid at offset h, the top limb of mid is zero if it would overflow */
+	size_t mn = std::min(2 * h + 1, rn - h);
+	_add(r + h, r + h, rn - h, mid, mn);
 }
 
-/*! multiply */
-Nat Nat::operator*(const Nat &operand) const
+/*
+ * toom-cook multiply
+ *
+ * operands are split into parts of k limbs and evaluated at 0, +1, -1,
+ * +2, -2, 1/2 and infinity as required by the number of points. inner
+ * point values are multiplied into L = 2k + 3 limb two's complement
+ * slots so interpolation is plain modular add, subtract, arithmetic
+ * shift and exact division by small odd constants. the products at 0
+ * and infinity are written directly to the result.
+ */
+
+/*! accumulate c * a_i into a k + 1 limb evaluation */
+static void _toom_addmul_part(limb_t *d, size_t k, const limb_t *a, size_t n, limb_t c)
 {
-	Nat result(0, s, bits);
-	mult(*this, operand, result);
-	result._contract();
-	return result;
+	limb_t carry = Nat::_addmul_1(d, a, n, c);
+	Nat::_add_1(d + n, d + n, k + 1 - n, carry);
 }
 
-/*! division quotient */
-Nat Nat::operator/(const Nat &divisor) const
+/*! evaluate a(2^sh) and |a(-2^sh)|, returning true if a(-2^sh) < 0 */
+static bool _toom_eval_pm(limb_t *pp, limb_t *pm, limb_t *t,
+	const limb_t *a, size_t k, size_t p, size_t ln, unsigned sh)
 {
-	Nat quotient(0, s, bits), remainder(0, s, bits);
-	divrem(*this, divisor, quotient, remainder);
-	return quotient;
+	std::fill(pp, pp + k + 1, 0);
+	std::fill(t, t + k + 1, 0);
+	for (size_t i = 0; i < p; i++) {
+		_toom_addmul_part((i & 1) ? t : pp, k, a + i * k, i == p - 1 ? ln : k, limb_t(1) << (i * sh));
+	}
+	bool neg = Nat::_abs_sub(pm, pp, k + 1, t, k + 1);
+	Nat::_add_n(pp, pp, t, k + 1);
+	return neg;
 }
 
-/*! division remainder */
-Nat Nat::operator%(const Nat &divisor) const
+/*! evaluate a(2) or 2^(p-1) * a(1/2) */
+static void _toom_eval_2(limb_t *d, const limb_t *a, size_t k, size_t p, size_t ln, bool half)
 {
-	Nat quotient(0), remainder(0);
-	divrem(*this, divisor, quotient, remainder);
-	return remainder;
+	std::fill(d, d + k + 1, 0);
+	for (size_t i = 0; i < p; i++) {
+		_toom_addmul_part(d, k, a + i * k, i == p - 1 ? ln : k, limb_t(1) << (half ? p - 1 - i : i));
+	}
 }
 
-/*! multiply equals */
-Nat& Nat::operator*=(const Nat &operand)
+/*! evaluate at the ni inner points +1, -1 [, +2 [, -2, 1/2]] */
+static void _toom_eval(limb_t *e, bool *neg, limb_t *t,
+	const limb_t *a, size_t k, size_t p, size_t ln, size_t ni)
 {
-	Nat result = *this * operand;
-	*this = std::move(result);
-	return *this;
+	size_t k1 = k + 1;
+	std::fill(neg, neg + ni, false);
+	neg[1] = _toom_eval_pm(e, e + k1, t, a, k, p, ln, 0);
+	if (ni == 3) {
+		_toom_eval_2(e + 2 * k1, a, k, p, ln, false);
+	} else if (ni == 5) {
+		neg[3] = _toom_eval_pm(e + 2 * k1, e + 3 * k1, t, a, k, p, ln, 1);
+		_toom_eval_2(e + 4 * k1, a, k, p, ln, true);
+	}
 }
 
-/*! divide equals */
-Nat& Nat::operator/=(const Nat &operand)
+/*! two's complement negate */
+static void _tc_neg(limb_t *s, size_t n)
 {
-	Nat result = *this / operand;
-	*this = std::move(result);
-	return *this;
+	for (size_t i = 0; i < n; i++) s[i] = ~s[i];
+	Nat::_add_1(s, s, n, 1);
 }
 
-/*! modulus equals */
-Nat& Nat::operator%=(const Nat &operand)
+/*! two's complement arithmetic right shift by less than limb_bits */
+static void _tc_shr(limb_t *s, size_t n, unsigned sh)
 {
-	Nat result = *this % operand;
-	*this = std::move(result);
-	return *this;
+	for (size_t i = 0; i + 1 < n; i++) {
+		s[i] = (s[i] >> sh) | (s[i + 1] << (Nat::limb_bits - sh));
+	}
+	s[n - 1] = limb_t(std::make_signed<limb_t>::type(s[n - 1]) >> sh);
 }
 
-
-/*--------------------.
-| power via squaring. |
-`--------------------*/
-
-/*! raise to the power */
-Nat Nat::pow(size_t exp) const
+/*! two's complement exact division by a small odd constant */
+static void _tc_divexact_1(limb_t *s, size_t n, limb_t d)
 {
-	if (exp == 0) return 1;
-	Nat x = *this, y = 1;
-	while (exp > 1) {
-		if ((exp & 1) == 0) {
-			exp >>= 1;
-		} else {
-			y *= x;
-			exp = (exp - 1) >> 1;
-		}
-		x *= x;
+	limb_t inv = d; /* d * d == 1 mod 8, each step doubles the correct bits */
+	for (int i = 0; i < 5; i++) inv *= 2 - d * inv;
+	limb_t c = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb_t x = s[i], y = x - c;
+		limb_t q = y * inv;
+		s[i] = q;
+		c = limb_t((limb2_t(q) * d) >> Nat::limb_bits) + (y > x);
 	}
-	return x * y;
 }
 
+/*! two's complement subtract m * x where x has xn <= n limbs */
+static void _tc_submul(limb_t *s, size_t n, const limb_t *x, size_t xn, limb_t m)
+{
+	limb_t borrow = Nat::_submul_1(s, x, xn, m);
+	Nat::_sub_1(s + xn, s + xn, n - xn, borrow);
+}
 
-/*-------------------.
-| string conversion. |
-`-------------------*/
+/*! two's complement add m * x where x has xn <= n limbs */
+static void _tc_addmul(limb_t *s, size_t n, const limb_t *x, size_t xn, limb_t m)
+{
+	limb_t carry = Nat::_addmul_1(s, x, xn, m);
+	Nat::_add_1(s + xn, s + xn, n - xn, carry);
+}
 
-/*! helper for recursive divide and conquer conversion to string */
-static inline ptrdiff_t _to_string_c(const Nat &val, std::string &s, ptrdiff_t offset)
+/*
+ * interpolate the inner coefficients from the inner point values
+ *
+ * c0 and cinf are the products at 0 and infinity. on return c[j] points
+ * to the slot holding coefficient j + 1.
+ */
+static void _toom_interp(limb_t *v, size_t L, size_t np,
+	const limb_t *c0, size_t c0n, const limb_t *ci, size_t cin, limb_t **c)
 {
-	limb2_t v = limb2_t(val.limb_at(0)) | (limb2_t(val.limb_at(1)) << Nat::limb_bits);
-	do {
-		s[--offset] = '0' + char(v % 10);
-	} while ((v /= 10) != 0);
-	return offset;
+	limb_t *s1 = v, *sm1 = v + L, *s2 = v + 2 * L, *sm2 = v + 3 * L, *sh = v + 4 * L;
+
+	/* O1 = (v(1) - v(-1)) / 2, E1 = v(1) - O1 */
+	Nat::_sub_n(sm1, s1, sm1, L);
+	_tc_shr(sm1, L, 1);
+	Nat::_sub_n(s1, s1, sm1, L);
+
+	switch (np) {
+	case 4:
+		/* c2 = E1 - c0, c1 = O1 - c3 */
+		Nat::_sub(s1, s1, L, c0, c0n);
+		Nat::_sub(sm1, sm1, L, ci, cin);
+		c[0] = sm1; c[1] = s1;
+		break;
+	case 5:
+		/* c2 = E1 - c0 - c4 */
+		Nat::_sub(s1, s1, L, c0, c0n);
+		Nat::_sub(s1, s1, L, ci, cin);
+		/* c3 = ((v(2) - c0 - 4c2 - 16c4) / 2 - O1) / 3, c1 = O1 - c3 */
+		Nat::_sub(s2, s2, L, c0, c0n);
+		_tc_submul(s2, L, s1, L, 4);
+		_tc_submul(s2, L, ci, cin, 16);
+		_tc_shr(s2, L, 1);
+		Nat::_sub_n(s2, s2, sm1, L);
+		_tc_divexact_1(s2, L, 3);
+		Nat::_sub_n(sm1, sm1, s2, L);
+		c[0] = sm1; c[1] = s1; c[2] = s2;
+		break;
+	case 7:
+		/* O2 = (v(2) - v(-2)) / 4, E2 = v(2) - 2 O2 */
+		Nat::_sub_n(sm2, s2, sm2, L);
+		_tc_shr(sm2, L, 2);
+		_tc_submul(s2, L, sm2, L, 2);
+		/* c2 + c4 = E1 - c0 - c6, c2 + 4c4 = (E2 - c0 - 64c6) / 4 */
+		Nat::_sub(s1, s1, L, c0, c0n);
+		Nat::_sub(s1, s1, L, ci, cin);
+		Nat::_sub(s2, s2, L, c0, c0n);
+		_tc_submul(s2, L, ci, cin, 64);
+		_tc_shr(s2, L, 2);
+		/* c4 = ((c2 + 4c4) - (c2 + c4)) / 3, c2 = (c2 + c4) - c4 */
+		Nat::_sub_n(s2, s2, s1, L);
+		_tc_divexact_1(s2, L, 3);
+		Nat::_sub_n(s1, s1, s2, L);
+		/* H = 16c1 + 4c3 + c5 = (v(1/2) - 64c0 - 16c2 - 4c4 - c6) / 2 */
+		_tc_submul(sh, L, c0, c0n, 64);
+		_tc_submul(sh, L, s1, L, 16);
+		_tc_submul(sh, L, s2, L, 4);
+		Nat::_sub(sh, sh, L, ci, cin);
+		_tc_shr(sh, L, 1);
+		/* P = c3 + 5c5 = (O2 - O1) / 3, Q = -4c3 - 5c5 = (H - 16 O1) / 3 */
+		Nat::_sub_n(sm2, sm2, sm1, L);
+		_tc_divexact_1(sm2, L, 3);
+		_tc_submul(sh, L, sm1, L, 16);
+		_tc_divexact_1(sh, L, 3);
+		/* c5 = (4P + Q) / 15, c3 = P - 5c5, c1 = O1 - c3 - c5 */
+		_tc_addmul(sh, L, sm2, L, 4);
+		_tc_divexact_1(sh, L, 15);
+		_tc_submul(sm2, L, sh, L, 5);
+		Nat::_sub_n(sm1, sm1, sm2, L);
+		Nat::_sub_n(sm1, sm1, sh, L);
+		c[0] = sm1; c[1] = s1; c[2] = sm2; c[3] = s2; c[4] = sh;
+		break;
+	}
 }
 
-/*! helper for recursive divide and conquer conversion to string */
-static ptrdiff_t _to_string_r(const Nat &val, std::vector<Nat> &sq, size_t level,
-	std::string &s, size_t digits, ptrdiff_t offset)
+/*
+ * toom-cook multiply splitting into pa and pb parts of k limbs
+ *
+ * toom-3 (3,3) and toom-4 (4,4) handle balanced operands while the
+ * toom-3.2 (3,2) and toom-4.2 (4,2) variants handle a multiplier that is
+ * one half to two thirds the length of the multiplicand.
+ *
+ * scratch layout: slots[ni * L] | ea[ni * (k+1)] | eb[ni * (k+1)] | t[k+1] | recursion
+ */
+void Nat::_mul_toom(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn,
+	size_t pa, size_t pb, size_t k, limb_t *ws)
 {
-	Nat q, r;
-	Nat::divrem(val, sq[level], q, r);
-	if (level > 0) {
-		if (r != 0) {
-			if (q != 0) {
-				_to_string_r(r, sq, level-1, s, digits >> 1, offset);
-				return _to_string_r(q, sq, level-1, s, digits >> 1, offset - digits);
-			} else {
-				return _to_string_r(r, sq, level-1, s, digits >> 1, offset);
-			}
+	size_t np = pa + pb - 1, ni = np - 2, k1 = k + 1, L = 2 * k + 3, rn = an + bn;
+	size_t lna = an - (pa - 1) * k, lnb = bn - (pb - 1) * k, ci = (np - 1) * k;
+	limb_t *v = ws, *ea = v + ni * L, *eb = ea + ni * k1, *t = eb + ni * k1, *ws2 = t + k1;
+	bool sa[5], sb[5];
+	limb_t *c[5];
+
+	/* squaring evaluates once and squares the point values */
+	if (a == b && an == bn) {
+		_toom_eval(ea, sa, t, a, k, pa, lna, ni);
+		_sqr(r, a, k, ws2);
+		std::fill(r + 2 * k, r + ci, 0);
+		_sqr(r + ci, a + (pa - 1) * k, lna, ws2);
+		for (size_t i = 0; i < ni; i++) {
+			limb_t *s = v + i * L;
+			_sqr(s, ea + i * k1, k1, ws2);
+			std::fill(s + 2 * k1, s + L, 0);
 		}
 	} else {
-		if (r != 0) {
-			if (q != 0) {
-				_to_string_c(r, s, offset);
-				offset = _to_string_c(q, s, offset - digits);
-			} else {
-				offset = _to_string_c(r, s, offset);
-			}
+		_toom_eval(ea, sa, t, a, k, pa, lna, ni);
+		_toom_eval(eb, sb, t, b, k, pb, lnb, ni);
+
+		/* products at 0 and infinity go directly to the result */
+		_mul(r, a, k, b, k, ws2);
+		std::fill(r + 2 * k, r + ci, 0);
+		_mul(r + ci, a + (pa - 1) * k, lna, b + (pb - 1) * k, lnb, ws2);
+
+		/* products at the inner points into two's complement slots */
+		for (size_t i = 0; i < ni; i++) {
+			limb_t *s = v + i * L;
+			_mul(s, ea + i * k1, k1, eb + i * k1, k1, ws2);
+			std::fill(s + 2 * k1, s + L, 0);
+			if (sa[i] != sb[i]) _tc_neg(s, L);
 		}
 	}
-	return offset;
+
+	_toom_interp(v, L, np, r, 2 * k, r + ci, rn - ci, c);
+
+	/* coefficients are non-negative and fit below the top of the result */
+	for (size_t j = 1; j <= ni; j++) {
+		size_t o = j * k;
+		_add(r + o, r + o, rn - o, c[j - 1], std::min(L, rn - o));
+	}
 }
 
-/*! convert from Nat to string */
-std::string Nat::to_string(size_t radix) const
+/*
+ * number theoretic transform multiply
+ *
+ * operands are split into 32-bit coefficients and convolved modulo three
+ * primes of the form c * 2^k + 1 using 32-bit montgomery arithmetic. the
+ * coefficients are recovered with garner's CRT. the product of the primes
+ * exceeds 2^89 so convolutions of up to 2^24 coefficients are exact.
+ * extra memory is five 32-bit words per transform point.
+ */
+
+enum { _ntt_max_log2 = 24 };
+
+/*! montgomery arithmetic modulo an NTT prime */
+struct _ntt_prime
 {
-	static const char* hexdigits = "0123456789abcdef";
-	static const Nat tenp18{0xa7640000, 0xde0b6b3};
-	static const size_t dgib = 3566893131; /* log2(10) * 1024^3 */
-
-	switch (radix) {
-		case 10: {
-			if (*this == 0) return "0";
-
-			/* estimate string length */
-			std::string s;
-			size_t climit = (size_t)(((long long)(num_limbs()) << (limb_shift + 30)) / (long long)dgib) + 1;
-			s.resize(climit, '0');
-
-			/* square the chunk size until ~= sqrt(n) */
-			Nat chunk = tenp18;
-			size_t digits = 18;
-			std::vector<Nat> sq = { tenp18 };
-			do {
-				chunk *= chunk;
-				digits <<= 1;
-				sq.push_back(chunk);
-			} while ((chunk.num_limbs() < ((num_limbs() >> 1) + 1)));
-
-			/* recursively divide by chunk squares */
-			ptrdiff_t offset = _to_string_r(*this, sq, sq.size() - 1, s, digits, climit);
-
-			/* return less reserve */
-			return s.substr(offset);
-		}
-		case 2: {
-			if (*this == 0) return "0b0";
-
-			std::string s("0b");
-			limb_t l1 = limbs.back();
-			size_t n = limb_bits - clz(l1);
-			size_t t = n + ((num_limbs() - 1) << limb_shift);
-			s.resize(t + 2);
-			auto i = s.begin() + 2;
-			for (ptrdiff_t k = n - 1; k >= 0; k--) {
-				*(i++) = '0' + ((l1 >> k) & 1);
+	uint32_t p, pinv, r1, r2, g;
+
+	_ntt_prime(uint32_t p, uint32_t g) : p(p), g(g)
+	{
+		pinv = p; /* p * p == 1 mod 8, each step doubles the correct bits */
+		for (int i = 0; i < 4; i++) pinv *= 2 - p * pinv;
+		pinv = -pinv;
+		r1 = uint32_t((uint64_t(1) << 32) % p);
+		r2 = uint32_t(uint64_t(r1) * r1 % p);
+	}
+
+	uint32_t redc(uint64_t t) const
+	{
+		uint32_t m = uint32_t(t) * pinv;
+		uint32_t r = uint32_t((t + uint64_t(m) * p) >> 32);
+		return r >= p ? r - p : r;
+	}
+
+	uint32_t mul(uint32_t a, uint32_t b) const { return redc(uint64_t(a) * b); }
+	uint32_t add(uint32_t a, uint32_t b) const { uint32_t s = a + b; return s >= p ? s - p : s; }
+	uint32_t sub(uint32_t a, uint32_t b) const { return a >= b ? a - b : a + p - b; }
+
+	/*! x^e with x and result in montgomery form */
+	uint32_t pow(uint32_t x, uint64_t e) const
+	{
+		uint32_t y = r1;
+		for (; e; e >>= 1, x = mul(x, x)) {
+			if (e & 1) y = mul(y, x);
+		}
+		return y;
+	}
+
+	/*! twiddles in montgomery form, tw[len + j] = w_2len^j */
+	void twiddles(uint32_t *tw, size_t n) const
+	{
+		for (size_t len = 1; len < n; len <<= 1) {
+			uint32_t w = pow(mul(g, r2), (p - 1) / (2 * len));
+			tw[len] = r1;
+			for (size_t j = 1; j < len; j++) {
+				tw[len + j] = mul(tw[len + j - 1], w);
 			}
-			for (ptrdiff_t j = num_limbs() - 2; j >= 0; j--) {
-				limb_t l = limbs[j];
-				for (ptrdiff_t k = limb_bits - 1; k >= 0; k--) {
-					*(i++) = '0' + ((l >> k) & 1);
+		}
+	}
+
+	/*! decimation in frequency transform, natural to bit reversed order */
+	void dif(uint32_t *a, size_t n, const uint32_t *tw) const
+	{
+		for (size_t len = n >> 1; len >= 1; len >>= 1) {
+			for (size_t i = 0; i < n; i += 2 * len) {
+				for (size_t j = 0; j < len; j++) {
+					uint32_t u = a[i + j], v = a[i + j + len];
+					a[i + j] = add(u, v);
+					a[i + j + len] = mul(sub(u, v), tw[len + j]);
 				}
 			}
-			return s;
-		}
-		case 16: {
-			if (*this == 0) return "0x0";
-
-			std::string s("0x");
-			limb_t l1 = limbs.back();
-			size_t n = ((limb_bits >> 2) - (clz(l1) >> 2));
-			size_t t = n + ((num_limbs() - 1) << (limb_shift - 2));
-			s.resize(t + 2);
-			auto i = s.begin() + 2;
-			for (ptrdiff_t k = n - 1; k >= 0; k--) {
-				*(i++) = hexdigits[(l1 >> (k << 2)) & 0xf];
-			}
-			for (ptrdiff_t j = num_limbs() - 2; j >= 0; j--) {
-				limb_t l = limbs[j];
-				for (ptrdiff_t k = (limb_bits >> 2) - 1; k >= 0; k--) {
-					*(i++) = hexdigits[(l >> (k << 2)) & 0xf];
+		}
+	}
+
+	/*! inverse decimation in time transform, bit reversed to natural order
+	 * using w^-j = -w^(len-j), the result is scaled by n */
+	void dit(uint32_t *a, size_t n, const uint32_t *tw) const
+	{
+		for (size_t len = 1; len < n; len <<= 1) {
+			for (size_t i = 0; i < n; i += 2 * len) {
+				uint32_t u = a[i], v = a[i + len];
+				a[i] = add(u, v);
+				a[i + len] = sub(u, v);
+				for (size_t j = 1; j < len; j++) {
+					uint32_t u = a[i + j], m = mul(a[i + j + len], tw[2 * len - j]);
+					a[i + j] = sub(u, m);
+					a[i + j + len] = add(u, m);
 				}
 			}
-			return s;
-		}
-		default: {
-			return std::string();
 		}
 	}
+};
+
+/*! number of 32-bit NTT coefficients per limb */
+enum { _ntt_cpl = Nat::limb_bits / 32 };
+
+/*! load 32-bit coefficients of a limb array into montgomery form */
+static void _ntt_load(const _ntt_prime &P, uint32_t *f, size_t n, const limb_t *a, size_t an)
+{
+	size_t nc = an * _ntt_cpl;
+	for (size_t i = 0; i < nc; i++) {
+		f[i] = P.mul(uint32_t(a[i / _ntt_cpl] >> (32 * (i % _ntt_cpl))), P.r2);
+	}
+	std::fill(f + nc, f + n, 0);
 }
 
-/*! convert to Nat from string */
-void Nat::from_string(const char *str, size_t len, size_t radix)
+/*! three prime NTT multiply into an + bn limbs (allocates transform buffers) */
+void Nat::_mul_ntt(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn)
 {
-	static const Nat tenp18{0xa7640000, 0xde0b6b3};
-	static const Nat twop64{0,0,1};
-	if (len > 2) {
-		if (strncmp(str, "0b", 2) == 0) {
-			radix = 2;
-			str += 2;
-			len -= 2;
-		} else if (strncmp(str, "0x", 2) == 0) {
+	static const _ntt_prime P[3] = {
+		_ntt_prime(2013265921, 31), /* 15 * 2^27 + 1 */
+		_ntt_prime(469762049, 3),   /*  7 * 2^26 + 1 */
+		_ntt_prime(754974721, 11),  /* 45 * 2^24 + 1 */
+	};
+	static const uint64_t p0 = P[0].p, p1 = P[1].p, p2 = P[2].p;
+	static const uint64_t inv01 = P[1].mul(P[1].pow(P[1].mul(uint32_t(p0 % p1), P[1].r2), p1 - 2), 1);
+	static const uint64_t inv012 = P[2].mul(P[2].pow(P[2].mul(uint32_t(p0 * p1 % p2), P[2].r2), p2 - 2), 1);
+
+	size_t nr = (an + bn) * _ntt_cpl, n = 1;
+	while (n < nr - 1) n <<= 1;
+	std::vector<uint32_t> res(3 * n), fb(n), tw(n);
+
+	/* convolve modulo each prime, scaling by 1/n while leaving montgomery form */
+	for (size_t k = 0; k < 3; k++) {
+		const _ntt_prime &Q = P[k];
+		uint32_t *fa = res.data() + k * n;
+		uint32_t ninv = Q.mul(Q.pow(Q.mul(uint32_t(n % Q.p), Q.r2), Q.p - 2), 1);
+		Q.twiddles(tw.data(), n);
+		_ntt_load(Q, fa, n, a, an);
+		Q.dif(fa, n, tw.data());
+		if (a == b && an == bn) {
+			for (size_t i = 0; i < n; i++) fa[i] = Q.mul(fa[i], fa[i]);
+		} else {
+			_ntt_load(Q, fb.data(), n, b, bn);
+			Q.dif(fb.data(), n, tw.data());
+			for (size_t i = 0; i < n; i++) fa[i] = Q.mul(fa[i], fb[i]);
+		}
+		Q.dit(fa, n, tw.data());
+		for (size_t i = 0; i < n; i++) fa[i] = Q.mul(fa[i], ninv);
+	}
+
+	/* garner recombination of coefficients, accumulating 32-bit words */
+	std::fill(r, r + an + bn, 0);
+	uint64_t c0 = 0, c1 = 0, c2 = 0;
+	for (size_t i = 0; i < nr; i++) {
+		if (i < nr - 1) {
+			uint64_t x0 = res[i], x1 = res[n + i], x2 = res[2 * n + i];
+			x1 = (x1 + p1 - x0 % p1) % p1 * inv01 % p1;
+			x2 = (x2 + p2 - (x0 + p0 * x1) % p2) % p2 * inv012 % p2;
+			/* value = x0 + p0 * (x1 + p1 * x2) as three 32-bit words */
+			uint64_t t = x1 + p1 * x2;
+			uint64_t lo = p0 * (t & 0xffffffff) + x0;
+			uint64_t hi = p0 * (t >> 32) + (lo >> 32);
+			c0 += lo & 0xffffffff;
+			c1 += hi & 0xffffffff;
+			c2 += hi >> 32;
+		}
+		r[i / _ntt_cpl] |= limb_t(c0 & 0xffffffff) << (32 * (i % _ntt_cpl));
+		c0 = c1 + (c0 >> 32);
+		c1 = c2;
+		c2 = 0;
+	}
+}
+
+/* multiply algorithms */
+enum { _mul_basecase_alg, _mul_karatsuba_alg, _mul_slice_alg, _mul_toom_alg, _mul_ntt_alg };
+
+/*! toom part size if splitting into pa and pb parts leaves every part non-empty */
+static size_t _toom_split(size_t an, size_t bn, size_t pa, size_t pb)
+{
+	size_t k = std::max((an + pa - 1) / pa, (bn + pb - 1) / pb);
+	return an > (pa - 1) * k && bn > (pb - 1) * k ? k : 0;
+}
+
+/*! select multiply algorithm for an >= bn */
+static int _mul_select(size_t an, size_t bn, size_t &pa, size_t &pb, size_t &k)
+{
+	if (bn < Nat::karatsuba_threshold) {
+		return _mul_basecase_alg;
+	}
+	if (bn >= Nat::ntt_threshold && (an + bn) * _ntt_cpl <= (size_t(1) << _ntt_max_log2)) {
+		return _mul_ntt_alg;
+	}
+	if (bn >= Nat::toom3_threshold) {
+		/* the ideal length ratios are 1, 3/2 and 2, choose the nearest */
+		if (an * 100 < bn * 122) {
+			if (bn >= Nat::toom4_threshold && (k = _toom_split(an, bn, 4, 4))) {
+				pa = pb = 4;
+				return _mul_toom_alg;
+			}
+			if ((k = _toom_split(an, bn, 3, 3))) {
+				pa = pb = 3;
+				return _mul_toom_alg;
+			}
+		} else if (an * 100 < bn * 173) {
+			if ((k = _toom_split(an, bn, 3, 2))) {
+				pa = 3; pb = 2;
+				return _mul_toom_alg;
+			}
+		} else if (an * 100 < bn * 245) {
+			if ((k = _toom_split(an, bn, 4, 2))) {
+				pa = 4; pb = 2;
+				return _mul_toom_alg;
+			}
+		}
+	}
+	return bn > (an + 1) >> 1 ? _mul_karatsuba_alg : _mul_slice_alg;
+}
+
+/*! multiply selecting algorithm by operand size into an + bn limbs */
+void Nat::_mul(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *ws)
+{
+	if (an < bn) {
+		std::swap(a, b);
+		std::swap(an, bn);
+	}
+	size_t pa, pb, k;
+	switch (_mul_select(an, bn, pa, pb, k)) {
+	case _mul_basecase_alg:
+		_mul_basecase(r, a, an, b, bn);
+		break;
+	case _mul_karatsuba_alg:
+		_mul_karatsuba(r, a, an, b, bn, ws);
+		break;
+	case _mul_toom_alg:
+		_mul_toom(r, a, an, b, bn, pa, pb, k, ws);
+		break;
+	case _mul_ntt_alg:
+		_mul_ntt(r, a, an, b, bn);
+		break;
+	case _mul_slice_alg: {
+		/* unbalanced: multiply bn limb slices of a and accumulate */
+		limb_t *t = ws, *ws2 = ws + 2 * bn;
+		_mul(r, a, bn, b, bn, ws2);
+		for (size_t o = bn; o < an; o += bn) {
+			size_t c = std::min(bn, an - o);
+			_mul(t, b, bn, a + o, c, ws2);
+			std::copy(t + bn, t + bn + c, r + o + bn);
+			_add(r + o, r + o, bn + c, t, bn);
+		}
+		break;
+	}
+	}
+}
+
+/*! number of scratch limbs needed by _mul */
+size_t Nat::_mul_scratch(size_t an, size_t bn)
+{
+	if (an < bn) {
+		std::swap(an, bn);
+	}
+	size_t pa, pb, k;
+	switch (_mul_select(an, bn, pa, pb, k)) {
+	case _mul_karatsuba_alg: {
+		size_t h = (an + 1) >> 1;
+		return 4 * h + 1 + _mul_scratch(h, h);
+	}
+	case _mul_toom_alg: {
+		size_t ni = pa + pb - 3, lna = an - (pa - 1) * k, lnb = bn - (pb - 1) * k;
+		size_t rec = std::max(std::max(_mul_scratch(k + 1, k + 1), _mul_scratch(k, k)),
+			std::max(_mul_scratch(lna, lnb), _sqr_scratch(k + 1)));
+		return ni * (2 * k + 3) + (2 * ni + 1) * (k + 1) + rec;
+	}
+	case _mul_slice_alg: {
+		size_t c = an % bn;
+		return 2 * bn + std::max(_mul_scratch(bn, bn), c ? _mul_scratch(bn, c) : 0);
+	}
+	default:
+		return 0;
+	}
+}
+
+/*! schoolbook square into 2n limbs */
+void Nat::_sqr_basecase(limb_t *r, const limb_t *a, size_t n)
+{
+	/* off diagonal products a[i] * a[j] for i < j, each computed once */
+	r[0] = r[2 * n - 1] = 0;
+	if (n > 1) {
+		r[n] = _mul_1(r + 1, a + 1, n - 1, a[0]);
+	}
+	for (size_t i = 1; i + 1 < n; i++) {
+		r[n + i] = _addmul_1(r + 2 * i + 1, a + i + 1, n - i - 1, a[i]);
+	}
+
+	/* double the off diagonal sum and add the diagonal squares */
+	limb_t carry = 0, hi = 0;
+	for (size_t i = 0; i < n; i++) {
+		limb2_t p = limb2_t(a[i]) * a[i];
+		limb_t r0 = r[2 * i], r1 = r[2 * i + 1];
+		limb2_t t = (limb2_t(r0 << 1 | hi)) + limb_t(p) + carry;
+		r[2 * i] = limb_t(t);
+		t = limb2_t(r1 << 1 | r0 >> (limb_bits - 1)) + limb_t(p >> limb_bits) + (t >> limb_bits);
+		r[2 * i + 1] = limb_t(t);
+		carry = limb_t(t >> limb_bits);
+		hi = r1 >> (limb_bits - 1);
+	}
+}
+
+/*
+ * karatsuba square into 2n limbs
+ *
+ * a^2 = a1^2 * B^2h + (a0^2 + a1^2 - (a0 - a1)^2) * B^h + a0^2
+ *
+ * scratch layout: t[2h] | da[h] | h + 1 | recursion
+ */
+void Nat::_sqr_karatsuba(limb_t *r, const limb_t *a, size_t n, limb_t *ws)
+{
+	size_t h = (n + 1) >> 1, rn = 2 * n;
+	limb_t *t = ws, *da = ws + 2 * h, *mid = da;
+	limb_t *ws2 = ws + 4 * h + 1;
+
+	_abs_sub(da, a, h, a + h, n - h);
+	_sqr(t, da, h, ws2);
+	_sqr(r, a, h, ws2);
+	_sqr(r + 2 * h, a + h, n - h, ws2);
+
+	/* mid = z0 + z2 - (a0 - a1)^2 */
+	mid[2 * h] = _add(mid, r, 2 * h, r + 2 * h, rn - 2 * h);
+	mid[2 * h] -= _sub_n(mid, mid, t, 2 * h);
+
+	size_t mn = std::min(2 * h + 1, rn - h);
+	_add(r + h, r + h, rn - h, mid, mn);
+}
+
+/*! square selecting algorithm by operand size into 2n limbs */
+void Nat::_sqr(limb_t *r, const limb_t *a, size_t n, limb_t *ws)
+{
+	size_t pa, pb, k;
+	if (n < karatsuba_sqr_threshold) {
+		_sqr_basecase(r, a, n);
+		return;
+	}
+	switch (_mul_select(n, n, pa, pb, k)) {
+	case _mul_toom_alg:
+		_mul_toom(r, a, n, a, n, pa, pb, k, ws);
+		break;
+	case _mul_ntt_alg:
+		_mul_ntt(r, a, n, a, n);
+		break;
+	default:
+		_sqr_karatsuba(r, a, n, ws);
+		break;
+	}
+}
+
+/*! number of scratch limbs needed by _sqr */
+size_t Nat::_sqr_scratch(size_t n)
+{
+	size_t pa, pb, k;
+	if (n < karatsuba_sqr_threshold) {
+		return 0;
+	}
+	switch (_mul_select(n, n, pa, pb, k)) {
+	case _mul_toom_alg:
+		return _mul_scratch(n, n);
+	case _mul_ntt_alg:
+		return 0;
+	default: {
+		size_t h = (n + 1) >> 1;
+		return 4 * h + 1 + _sqr_scratch(h);
+	}
+	}
+}
+
+/*! reciprocal floor((B^2 - 1) / d) - B of a normalized limb */
+inline static limb_t _invert_limb(limb_t d)
+{
+	return limb_t((limb2_t(~d) << Nat::limb_bits | limb_t(-1)) / d);
+}
+
+/*! reciprocal floor((B^3 - 1) / <d1,d0>) - B of normalized limbs */
+inline static limb_t _invert_pi1(limb_t d1, limb_t d0)
+{
+	limb_t v = _invert_limb(d1), p = d1 * v + d0;
+	if (p < d0) {
+		v--;
+		if (p >= d1) {
+			v--;
+			p -= d1;
+		}
+		p -= d1;
+	}
+	limb2_t t = limb2_t(d0) * v;
+	limb_t t1 = limb_t(t >> Nat::limb_bits), t0 = limb_t(t);
+	p += t1;
+	if (p < t1) {
+		v--;
+		if (p > d1 || (p == d1 && t0 >= d0)) {
+			v--;
+		}
+	}
+	return v;
+}
+
+/*!
+ * divide <u1,u0> by normalized d where u1 < d using the reciprocal v
+ * (Moller and Granlund, division by invariant integers, algorithm 4)
+ */
+inline static limb_t _div_2by1(limb_t &r, limb_t u1, limb_t u0, limb_t d, limb_t v)
+{
+	limb2_t qq = limb2_t(v) * u1 + (limb2_t(u1) << Nat::limb_bits | u0);
+	limb_t q = limb_t(qq >> Nat::limb_bits) + 1, q0 = limb_t(qq);
+	r = u0 - q * d;
+	if (r > q0) {
+		q--;
+		r += d;
+	}
+	if (r >= d) {
+		q++;
+		r -= d;
+	}
+	return q;
+}
+
+/*!
+ * divide <n2,n1,n0> by normalized <d1,d0> where <n2,n1> < <d1,d0> using
+ * the reciprocal v, leaving the remainder in <r1,r0> (algorithm 5)
+ */
+inline static limb_t _div_3by2(limb_t &r1, limb_t &r0, limb_t n2, limb_t n1, limb_t n0,
+	limb_t d1, limb_t d0, limb_t v)
+{
+	const limb2_t d = limb2_t(d1) << Nat::limb_bits | d0;
+	limb2_t qq = limb2_t(v) * n2 + (limb2_t(n2) << Nat::limb_bits | n1);
+	limb_t q = limb_t(qq >> Nat::limb_bits), q0 = limb_t(qq);
+	limb2_t r = (limb2_t(limb_t(n1 - d1 * q)) << Nat::limb_bits | n0) - d - limb2_t(d0) * q;
+	q++;
+	if (limb_t(r >> Nat::limb_bits) >= q0) {
+		q--;
+		r += d;
+	}
+	if (r >= d) {
+		q++;
+		r -= d;
+	}
+	r1 = limb_t(r >> Nat::limb_bits);
+	r0 = limb_t(r);
+	return q;
+}
+
+/*! reciprocal used by the division kernels for normalized d of dn limbs */
+static limb_t _div_inverse(const limb_t *d, size_t dn)
+{
+	return dn > 1 ? _invert_pi1(d[dn - 1], d[dn - 2]) : _invert_limb(d[0]);
+}
+
+/*!
+ * divide n limbs of u by a single limb d shifted left s bits to normalize
+ * it, using the 2/1 reciprocal of the normalized limb. the quotient is
+ * written to n limbs of q, which may alias u, and the remainder returned.
+ */
+limb_t Nat::_div_1(limb_t *q, const limb_t *u, size_t n, limb_t d, limb_t dinv, int s)
+{
+	limb_t r = 0;
+	if (s == 0) {
+		for (size_t j = n; j-- > 0; ) {
+			q[j] = _div_2by1(r, r, u[j], d, dinv);
+		}
+		return r;
+	}
+	limb_t hi = u[n - 1];
+	r = hi >> (limb_bits - s);
+	for (size_t j = n; j-- > 0; ) {
+		limb_t lo = j ? u[j - 1] : 0;
+		q[j] = _div_2by1(r, r, hi << s | lo >> (limb_bits - s), d, dinv);
+		hi = lo;
+	}
+	return r >> s;
+}
+
+/*!
+ * schoolbook divide of un limbs by normalized dn limbs (Knuth algorithm D)
+ * with quotient limbs from a 3/2 division by the top divisor limbs using
+ * their precomputed reciprocal dinv. the low un - dn quotient limbs are
+ * written to q, the remainder is left in u[0..dn) and the high quotient
+ * limb (0 or 1) is returned.
+ */
+limb_t Nat::_div_basecase(limb_t *q, limb_t *u, size_t un, const limb_t *d, size_t dn, limb_t dinv)
+{
+	limb_t qh = _cmp(u + un - dn, dn, d, dn) >= 0;
+	if (qh) {
+		_sub_n(u + un - dn, u + un - dn, d, dn);
+	}
+	if (dn == 1) {
+		/* the top limb of a larger divisor has a different reciprocal */
+		limb_t r = u[un - 1], v = _invert_limb(d[0]);
+		for (size_t j = un - 1; j-- > 0; ) {
+			q[j] = _div_2by1(r, r, u[j], d[0], v);
+		}
+		u[0] = r;
+		return qh;
+	}
+	limb_t d1 = d[dn - 1], d0 = d[dn - 2];
+	for (size_t j = un - dn; j-- > 0; ) {
+		limb_t n2 = u[j + dn], n1 = u[j + dn - 1], n0 = u[j + dn - 2], r1, r0, qj;
+		if (n2 == d1 && n1 == d0) {
+			qj = limb_t(-1);
+			_submul_1(u + j, d, dn, qj);
+			u[j + dn] = 0;
+		} else {
+			/* top three limbs divided exactly, then subtract the rest */
+			qj = _div_3by2(r1, r0, n2, n1, n0, d1, d0, dinv);
+			limb_t cy = _submul_1(u + j, d, dn - 2, qj);
+			limb_t cy1 = r0 < cy;
+			r0 -= cy;
+			cy = r1 < cy1;
+			r1 -= cy1;
+			u[j + dn - 2] = r0;
+			if (cy) {
+				r1 += d1 + _add_n(u + j, u + j, d, dn - 1);
+				qj--;
+			}
+			u[j + dn - 1] = r1;
+			u[j + dn] = 0;
+		}
+		q[j] = qj;
+	}
+	return qh;
+}
+
+/*!
+ * divide-and-conquer divide of 2n limbs by normalized n limbs (Burnikel and
+ * Ziegler). the high half of the quotient comes from the top 2 * ceil(n/2)
+ * limbs divided by the top ceil(n/2) divisor limbs, then is corrected with
+ * one product against the low divisor limbs, likewise for the low half.
+ * every sub-divisor shares the top two limbs so dinv serves all levels.
+ * quotient is written to n limbs of q, remainder is left in u[0..n) and
+ * the high quotient limb is returned.
+ */
+limb_t Nat::_div_dc_n(limb_t *q, limb_t *u, const limb_t *d, size_t n, limb_t dinv, limb_t *ws)
+{
+	size_t lo = n >> 1, hi = n - lo;
+	limb_t qh, ql, cy;
+
+	qh = hi < bz_threshold ? _div_basecase(q + lo, u + 2 * lo, 2 * hi, d + lo, hi, dinv)
+		: _div_dc_n(q + lo, u + 2 * lo, d + lo, hi, dinv, ws);
+	_mul(ws, q + lo, hi, d, lo, ws + n);
+	cy = _sub_n(u + lo, u + lo, ws, n);
+	if (qh) {
+		cy += _sub_n(u + n, u + n, d, lo);
+	}
+	while (cy) {
+		qh -= _sub_1(q + lo, q + lo, hi, 1);
+		cy -= _add_n(u + lo, u + lo, d, n);
+	}
+
+	ql = lo < bz_threshold ? _div_basecase(q, u + hi, 2 * lo, d + hi, lo, dinv)
+		: _div_dc_n(q, u + hi, d + hi, lo, dinv, ws);
+	_mul(ws, d, hi, q, lo, ws + n);
+	cy = _sub_n(u, u, ws, n);
+	if (ql) {
+		cy += _sub_n(u + lo, u + lo, d, hi);
+	}
+	while (cy) {
+		_sub_1(q, q, lo, 1);
+		cy -= _add_n(u, u, d, n);
+	}
+
+	return qh;
+}
+
+/*! number of scratch limbs needed by _div_dc_n */
+static size_t _div_dc_scratch(size_t n)
+{
+	if (n < Nat::bz_threshold) {
+		return 0;
+	}
+	size_t lo = n >> 1, hi = n - lo;
+	return std::max(n + Nat::_mul_scratch(hi, lo), _div_dc_scratch(hi));
+}
+
+/*!
+ * divide un limbs by normalized dn limbs selecting algorithm by divisor
+ * size. large quotients are split into blocks of dn limbs each divided
+ * with _div_dc_n, the top block taking the remaining qn mod dn limbs.
+ * quotient is written to un - dn limbs of q, remainder is left in
+ * u[0..dn) and the high quotient limb is returned.
+ */
+limb_t Nat::_div(limb_t *q, limb_t *u, size_t un, const limb_t *d, size_t dn, limb_t dinv, limb_t *ws)
+{
+	size_t qn = un - dn;
+	if (dn < bz_threshold || qn < bz_threshold) {
+		return _div_basecase(q, u, un, d, dn, dinv);
+	}
+
+	size_t b = qn % dn ? qn % dn : dn, o = qn - b;
+	limb_t qh, cy;
+	if (b < bz_threshold) {
+		qh = _div_basecase(q + o, u + o, dn + b, d, dn, dinv);
+	} else {
+		qh = _div_dc_n(q + o, u + o + dn - b, d + dn - b, b, dinv, ws);
+		if (b != dn) {
+			if (b >= dn - b) {
+				_mul(ws, q + o, b, d, dn - b, ws + dn);
+			} else {
+				_mul(ws, d, dn - b, q + o, b, ws + dn);
+			}
+			cy = _sub_n(u + o, u + o, ws, dn);
+			if (qh) {
+				cy += _sub_n(u + o + b, u + o + b, d, dn - b);
+			}
+			while (cy) {
+				qh -= _sub_1(q + o, q + o, b, 1);
+				cy -= _add_n(u + o, u + o, d, dn);
+			}
+		}
+	}
+	while (o > 0) {
+		o -= dn;
+		_div_dc_n(q + o, u + o, d, dn, dinv, ws);
+	}
+	return qh;
+}
+
+/*! number of scratch limbs needed by _div */
+size_t Nat::_div_scratch(size_t un, size_t dn)
+{
+	size_t qn = un - dn;
+	if (dn < bz_threshold || qn < bz_threshold) {
+		return 0;
+	}
+	size_t b = qn % dn ? qn % dn : dn;
+	return std::max(dn + _mul_scratch(b, dn - b), _div_dc_scratch(dn));
+}
+
+/*--------------------.
+| multply and divide. |
+`--------------------*/
+
+/* These routines are derived from Hacker's Delight */
+
+/*! thread local workspace for calls without an explicit scratch */
+static Nat::scratch& _thread_scratch()
+{
+	static thread_local Nat::scratch ws;
+	return ws;
+}
+
+/*! number of scratch limbs needed by _mul_low */
+static size_t _mul_low_scratch(size_t k, const limb_t *a, size_t m, const limb_t *b, size_t n)
+{
+	size_t mk = std::min(m, k), nk = std::min(n, k);
+	bool square = a == b && mk == nk;
+	if (square && mk + nk == k) {
+		return Nat::_sqr_scratch(mk);
+	} else if (std::min(mk, nk) >= Nat::karatsuba_threshold) {
+		return (mk + nk == k ? 0 : mk + nk) + Nat::_mul_scratch(mk, nk);
+	}
+	return 0;
+}
+
+/*! low k limbs (k <= m + n) of a times b into r, which must not alias a or b */
+static void _mul_low(limb_t *r, size_t k, const limb_t *a, size_t m, const limb_t *b, size_t n, limb_t *ws)
+{
+	/* only the low k limbs of each operand contribute to the product */
+	size_t mk = std::min(m, k), nk = std::min(n, k);
+	bool square = a == b && mk == nk;
+	if (square && mk + nk == k) {
+		Nat::_sqr(r, a, mk, ws);
+		return;
+	} else if (std::min(mk, nk) >= Nat::karatsuba_threshold) {
+		if (mk + nk == k) {
+			Nat::_mul(r, a, mk, b, nk, ws);
+		} else {
+			Nat::_mul(ws, a, mk, b, nk, ws + mk + nk);
+			std::copy(ws, ws + k, r);
+		}
+		return;
+	}
+
+	/* truncating schoolbook multiply computes only the low k limbs */
+	limb_t carry = 0;
+	limb2_t mj = b[0];
+	for (size_t i = 0; i < m && i < k; i++) {
+		limb2_t t = limb2_t(a[i]) * mj + carry;
+		r[i] = limb_t(t);
+		carry = t >> Nat::limb_bits;
+	}
+	if (m < k) {
+		r[m] = carry;
+	}
+	for (size_t j = 1; j < n; j++) {
+		carry = 0;
+		mj = b[j];
+		for (size_t i = 0; i < m && i + j < k; i++) {
+			limb2_t t = limb2_t(a[i]) * mj + limb2_t(r[i + j]) + carry;
+			r[i + j] = limb_t(t);
+			carry = t >> Nat::limb_bits;
+		}
+		if (j + m < k) {
+			r[j + m] = carry;
+		}
+	}
+}
+
+/*! base 2^limb_bits multiply */
+void Nat::mult(const Nat &multiplicand, const Nat &multiplier, Nat &result)
+{
+	mul_into(result, multiplicand, multiplier);
+}
+
+/*! base 2^limb_bits square */
+void Nat::sqr(const Nat &operand, Nat &result)
+{
+	mul_into(result, operand, operand);
+}
+
+/*! result = a * b, staging through scratch when result aliases an operand */
+void Nat::mul_into(Nat &result, const Nat &a, const Nat &b, scratch *ws)
+{
+	size_t m = a.num_limbs(), n = b.num_limbs();
+	size_t k = std::min(a.max_limbs(), m + n);
+	const limb_t *ap = a.limbs.data(), *bp = b.limbs.data();
+	bool alias = &result == &a || &result == &b;
+	size_t tn = alias ? k : 0;
+	limb_t *t = (ws ? *ws : _thread_scratch()).get(tn + _mul_low_scratch(k, ap, m, bp, n));
+
+	if (alias) {
+		_mul_low(t, k, ap, m, bp, n, t + tn);
+		result._resize(k);
+		std::copy(t, t + k, result.limbs.begin());
+	} else {
+		result._resize(k);
+		_mul_low(result.limbs.data(), k, ap, m, bp, n, t);
+	}
+	result.s = a.s;
+	result.bits = a.bits;
+	result._contract();
+}
+
+/*! result += a * b, the product is formed in scratch so may alias result */
+void Nat::mul_add_into(Nat &result, const Nat &a, const Nat &b, scratch *ws)
+{
+	size_t m = a.num_limbs(), n = b.num_limbs();
+	size_t k = std::min(result.max_limbs(), m + n);
+	const limb_t *ap = a.limbs.data(), *bp = b.limbs.data();
+	limb_t *t = (ws ? *ws : _thread_scratch()).get(k + _mul_low_scratch(k, ap, m, bp, n));
+
+	_mul_low(t, k, ap, m, bp, n, t + k);
+	size_t rn = std::min(result.max_limbs(), std::max(result.num_limbs(), k) + 1);
+	result._resize(rn);
+	_add(result.limbs.data(), result.limbs.data(), rn, t, k);
+	result._contract();
+}
+
+/*!
+ * divide by n normalized limbs vn with reciprocal dinv, shifting the
+ * dividend left s bits into m + 1 + _div_scratch(m + 1, n) limbs of un.
+ * the dividend is copied before the quotient and remainder are written
+ * so these may alias it.
+ */
+static void _divrem_norm(const Nat &dividend, const limb_t *vn, size_t n, int s,
+	limb_t dinv, limb_t *un, Nat &quotient, Nat &remainder)
+{
+	size_t m = dividend.num_limbs();
+	const limb_t *u = dividend.limbs.data();
+	un[m] = shr_comp(u[m-1], s);
+	for (size_t i = m - 1; i > 0; i--) {
+		un[i] = (u[i] << s) | shr_comp(u[i-1], s);
+	}
+	un[0] = u[0] << s;
+
+	// Divide, the high quotient limb is zero as un[m] < vn[n-1].
+	quotient._resize(m - n + 1);
+	Nat::_div(quotient.limbs.data(), un, m + 1, vn, n, dinv, un + m + 1);
+
+	// normalize remainder
+	remainder._resize(n);
+	limb_t *r = remainder.limbs.data();
+	for (size_t i = 0; i < n; i++) {
+		r[i] = (un[i] >> s) | shl_comp(i + 1 < n ? un[i + 1] : 0, s);
+	}
+
+	quotient._contract();
+	remainder._contract();
+}
+
+/*! base 2^limb_bits division */
+void Nat::divrem(const Nat &dividend, const Nat &divisor, Nat &quotient, Nat &remainder)
+{
+	size_t m = dividend.num_limbs(), n = divisor.num_limbs();
+	const limb_t *v = divisor.limbs.data();
+
+	if (m < n || n == 0 || v[n-1] == 0) {
+		remainder = dividend;
+		quotient = 0;
+		return;
+	}
+
+	// Normalize by shifting v left just enough so that
+	// its high-order bit is on, and shift u left the
+	// same amount. We may have to append a high-order
+	// digit on the dividend; we do that unconditionally.
+
+	int s = clz(v[n-1]); // 0 <= s <= limb_bits.
+
+	// Single digit divisor, quotient limbs are written
+	// after the dividend limb is read so may alias it.
+	// The reciprocal costs about one hardware divide so
+	// is only computed for longer dividends.
+	if (n == 1) {
+		limb_t d = v[0], r;
+		quotient._resize(m);
+		const limb_t *u = dividend.limbs.data();
+		limb_t *q = quotient.limbs.data();
+		if (m < 3) {
+			limb2_t k = 0;
+			for (size_t j = m; j-- > 0; ) {
+				limb2_t t = k << limb_bits | u[j];
+				q[j] = limb_t(t / d);
+				k = t - limb2_t(q[j]) * d;
+			}
+			r = limb_t(k);
+		} else {
+			r = _div_1(q, u, m, d << s, _invert_limb(d << s), s);
+		}
+		remainder = r;
+		quotient._contract();
+		return;
+	}
+
+	// Huge divisor and quotient, multiply by the reciprocal.
+	if (n >= newton_threshold && m - n >= newton_threshold) {
+		Reciprocal(divisor).divrem(dividend, quotient, remainder);
+		return;
+	}
+
+	limb_t *vn = _thread_scratch().get(n + m + 1 + _div_scratch(m + 1, n));
+	for (size_t i = n - 1; i > 0; i--) {
+		vn[i] = (v[i] << s) | shr_comp(v[i-1], s);
+	}
+	vn[0] = v[0] << s;
+	_divrem_norm(dividend, vn, n, s, _div_inverse(vn, n), vn + n, quotient, remainder);
+}
+
+/*! precompute normalization and reciprocal of divisor */
+Nat::Divisor::Divisor(const Nat &divisor) : dinv(0), shift(0)
+{
+	size_t n = divisor.num_limbs();
+	const limb_t *v = divisor.limbs.data();
+	while (n > 0 && v[n-1] == 0) {
+		n--;
+	}
+	if (n == 0) return;
+	shift = clz(v[n-1]);
+	d.resize(n);
+	for (size_t i = n - 1; i > 0; i--) {
+		d[i] = (v[i] << shift) | shr_comp(v[i-1], shift);
+	}
+	d[0] = v[0] << shift;
+	dinv = _div_inverse(d.data(), n);
+}
+
+/*! base 2^limb_bits division by a precomputed divisor */
+void Nat::divrem(const Nat &dividend, const Divisor &divisor, Nat &quotient, Nat &remainder)
+{
+	size_t m = dividend.num_limbs(), n = divisor.d.size();
+
+	if (m < n || n == 0) {
+		remainder = dividend;
+		quotient = 0;
+		return;
+	}
+
+	if (n == 1) {
+		quotient._resize(m);
+		limb_t r = _div_1(quotient.limbs.data(), dividend.limbs.data(), m,
+			divisor.d[0], divisor.dinv, divisor.shift);
+		remainder = r;
+		quotient._contract();
+		return;
+	}
+
+	limb_t *un = _thread_scratch().get(m + 1 + _div_scratch(m + 1, n));
+	_divrem_norm(dividend, divisor.d.data(), n, divisor.shift, divisor.dinv, un, quotient, remainder);
+}
+
+/*! multiply */
+Nat Nat::operator*(const Nat &operand) const
+{
+	Nat result(0, s, bits);
+	mul_into(result, *this, operand);
+	return result;
+}
+
+/*! division quotient */
+Nat Nat::operator/(const Nat &divisor) const
+{
+	Nat quotient(0, s, bits), remainder(0, s, bits);
+	divrem(*this, divisor, quotient, remainder);
+	return quotient;
+}
+
+/*! division remainder */
+Nat Nat::operator%(const Nat &divisor) const
+{
+	Nat quotient(0), remainder(0);
+	divrem(*this, divisor, quotient, remainder);
+	return remainder;
+}
+
+
+/*! division quotient by a precomputed divisor */
+Nat Nat::operator/(const Divisor &divisor) const
+{
+	Nat quotient(0, s, bits), remainder(0, s, bits);
+	divrem(*this, divisor, quotient, remainder);
+	return quotient;
+}
+
+/*! division remainder by a precomputed divisor */
+Nat Nat::operator%(const Divisor &divisor) const
+{
+	Nat quotient(0), remainder(0);
+	divrem(*this, divisor, quotient, remainder);
+	return remainder;
+}
+/*! multiply equals */
+Nat& Nat::operator*=(const Nat &operand)
+{
+	mul_into(*this, *this, operand);
+	return *this;
+}
+
+/*! divide equals */
+Nat& Nat::operator/=(const Nat &operand)
+{
+	Nat result = *this / operand;
+	*this = std::move(result);
+	return *this;
+}
+
+/*! modulus equals */
+Nat& Nat::operator%=(const Nat &operand)
+{
+	Nat result = *this % operand;
+	*this = std::move(result);
+	return *this;
+}
+
+
+/*--------------------.
+| power via squaring. |
+`--------------------*/
+
+/*! raise to the power */
+Nat Nat::pow(size_t exp) const
+{
+	if (exp == 0) return 1;
+	Nat x = *this, y = 1;
+	while (exp > 1) {
+		if ((exp & 1) == 0) {
+			exp >>= 1;
+		} else {
+			y *= x;
+			exp = (exp - 1) >> 1;
+		}
+		sqr(x, x);
+	}
+	return x * y;
+}
+
+
+/*---------------------.
+| reciprocal division. |
+`---------------------*/
+
+/*!
+ * Newton iteration for v within a few units of floor(B^2n / d) where d
+ * has n limbs with the high bit set. the reciprocal of the top h limbs
+ * has about h correct limbs, which one step v' = v + v(B^2n - dv) / B^2n
+ * doubles. h carries one guard limb so the error does not accumulate
+ * across levels, and only the high limbs of the error term are used.
+ */
+static Nat _recip(const Nat &d, size_t n)
+{
+	const size_t lb = Nat::limb_bits;
+	if (n <= 2 || n < Nat::newton_threshold) {
+		/* divide by a Divisor so divrem does not dispatch back to Newton */
+		Nat q, r;
+		Nat::divrem(Nat(1) << (2 * n * lb), Nat::Divisor(d), q, r);
+		return q;
+	}
+	size_t h = (n >> 1) + 1, w = n - h;
+	Nat vh = _recip(d >> (w * lb), h);
+	Nat p = (d * vh) << (w * lb);
+	Nat b2n = Nat(1) << (2 * n * lb);
+	Nat v = vh << (w * lb);
+	if (p <= b2n) {
+		Nat e = (b2n - p) >> ((n - 1) * lb);
+		v += (vh * e) >> ((h + 1) * lb);
+	} else {
+		Nat e = (p - b2n) >> ((n - 1) * lb);
+		v -= ((vh * e) >> ((h + 1) * lb)) + 1;
+	}
+	return v;
+}
+
+/*! compute the reciprocal of divisor */
+Nat::Reciprocal::Reciprocal(const Nat &divisor) : n(0), shift(0)
+{
+	d.limbs = divisor.limbs;
+	d._contract();
+	if (d == 0) return;
+	n = d.num_limbs();
+	shift = clz(d.limbs.back());
+	d <<= shift;
+	v = _recip(d, n);
+}
+
+/*!
+ * divide by the divisor. the shifted dividend is consumed in blocks of
+ * n limbs from the top, each block x = r * B^n + u_i < d * B^n giving
+ * n quotient limbs estimated from the high limbs of x times v.
+ */
+void Nat::Reciprocal::divrem(const Nat &dividend, Nat &quotient, Nat &remainder) const
+{
+	if (n == 0) {
+		remainder = dividend;
+		quotient = 0;
+		return;
+	}
+
+	Nat u, q, r, x;
+	u.limbs = dividend.limbs;
+	u <<= shift;
+	size_t m = u.num_limbs(), c = (m + n - 1) / n;
+	q._resize(c * n);
+	for (size_t i = c; i-- > 0; ) {
+		size_t o = i * n;
+		x.limbs.assign(u.limbs.data() + o, std::min(n, m - o));
+		if (r != 0) {
+			x._resize(n);
+			for (size_t j = 0; j < r.num_limbs(); j++) {
+				x.limbs.push_back(r.limbs[j]);
+			}
+		}
+		x._contract();
+
+		/* estimate may be a few units either side of floor(x / d) */
+		Nat qi = ((x >> ((n - 1) * limb_bits)) * v) >> ((n + 1) * limb_bits);
+		Nat t = qi * d;
+		while (t > x) {
+			qi -= 1;
+			t -= d;
+		}
+		r = x - t;
+		while (r >= d) {
+			qi += 1;
+			r -= d;
+		}
+		std::copy(qi.limbs.begin(), qi.limbs.end(), q.limbs.begin() + o);
+	}
+	r >>= shift;
+
+	quotient.limbs = std::move(q.limbs);
+	quotient._contract();
+	remainder.limbs = std::move(r.limbs);
+	remainder._contract();
+}
+
+/*--------------.
+| radix codecs. |
+`--------------*/
+
+/*! digits per leaf chunk, the largest c with radix^c < 2^63 */
+static unsigned _chunk_digits(size_t radix)
+{
+	unsigned c = 0;
+	for (unsigned long long p = 1; p <= ((1ULL << 63) - 1) / radix; p *= radix) c++;
+	return c;
+}
+
+/*! number of digits in an alphabet, throwing std::invalid_argument if not 2 to 255 */
+static size_t _alphabet_radix(const std::string &alphabet)
+{
+	if (alphabet.size() < 2 || alphabet.size() > 255) {
+		throw std::invalid_argument("alphabet must have 2 to 255 digits");
+	}
+	return alphabet.size();
+}
+
+/*!
+ * digit alphabet and parameters for conversion in one radix. digits of a
+ * power of two radix are packed bpd bits each, other radices convert by
+ * divide and conquer down to leaves of two chunks that each fit 63 bits,
+ * and parse dpl digits per limb with base = radix^dpl. simd is set for
+ * the built in binary and hex digits, which have vector kernels.
+ */
+struct _radix_codec
+{
+	size_t radix;
+	std::string digits;
+	unsigned char value[256];
+	unsigned bpd;
+	unsigned chunk;
+	unsigned dpl;
+	limb_t base;
+	Nat::Divisor leaf;
+	bool simd;
+
+	_radix_codec(const std::string &alphabet, bool fold_case);
+};
+
+/*! codec for an alphabet of 2 to 255 distinct characters */
+_radix_codec::_radix_codec(const std::string &alphabet, bool fold_case)
+	: radix(_alphabet_radix(alphabet)), digits(alphabet), bpd(0),
+	  chunk(_chunk_digits(radix)), dpl(0), base(1),
+	  leaf(Nat(limb_t(radix)).pow(chunk)), simd(fold_case && (radix == 2 || radix == 16))
+{
+	std::fill(value, value + 256, (unsigned char)255);
+	for (size_t i = 0; i < radix; i++) {
+		unsigned char c = (unsigned char)alphabet[i];
+		if (value[c] != 255) {
+			throw std::invalid_argument("alphabet has a repeated digit");
+		}
+		value[c] = (unsigned char)i;
+		if (fold_case && c >= 'a' && c <= 'z') {
+			value[c - 'a' + 'A'] = (unsigned char)i;
+		}
+	}
+	if ((radix & (radix - 1)) == 0) {
+		while ((size_t(1) << bpd) < radix) bpd++;
+	}
+	for (limb_t m = limb_t(-1) / radix; base <= m; base *= limb_t(radix)) dpl++;
+}
+
+/*! codec for a radix from 2 to 36, with letters in either case */
+static const _radix_codec& _builtin_codec(size_t radix)
+{
+	static const std::vector<_radix_codec> codecs = [] {
+		std::vector<_radix_codec> v;
+		for (size_t r = 2; r <= 36; r++) {
+			v.emplace_back(std::string("0123456789abcdefghijklmnopqrstuvwxyz", r), true);
+		}
+		return v;
+	}();
+	return codecs[radix - 2];
+}
+
+/*! value of a digit, throwing std::invalid_argument if it is not a digit */
+static inline limb_t _digit(const _radix_codec &rc, char c)
+{
+	unsigned d = rc.value[(unsigned char)c];
+	if (d >= rc.radix) {
+		throw std::invalid_argument("invalid digit");
+	}
+	return d;
+}
+
+
+/*-------------------.
+| radix power cache. |
+`-------------------*/
+
+typedef std::vector<std::shared_ptr<const Nat>> _power_table;
+
+/* radix^(chunk * 2^k) by radix, shared between threads under _power_mutex */
+static std::mutex _power_mutex;
+static _power_table _power_tables[256];
+static size_t _power_limbs;
+
+/*!
+ * extend sq to hold radix^(chunk * 2^k) for k up to and including level.
+ * entries are taken from the shared table, and missing entries are
+ * squared outside the lock then published if the table has not grown in
+ * the meantime and the limbs fit within power_cache_limit. a snapshot
+ * stays valid after the cache is cleared.
+ */
+static void _radix_powers(_power_table &sq, size_t radix, size_t level)
+{
+	if (sq.size() > level) return;
+	{
+		std::lock_guard<std::mutex> lock(_power_mutex);
+		const _power_table &t = _power_tables[radix];
+		for (size_t k = sq.size(); k < t.size() && k <= level; k++) {
+			sq.push_back(t[k]);
+		}
+	}
+	while (sq.size() <= level) {
+		std::shared_ptr<Nat> p = std::make_shared<Nat>();
+		if (sq.empty()) {
+			*p = Nat(limb_t(radix)).pow(_chunk_digits(radix));
+		} else {
+			Nat::sqr(*sq.back(), *p);
+		}
+		sq.push_back(p);
+		std::lock_guard<std::mutex> lock(_power_mutex);
+		_power_table &t = _power_tables[radix];
+		if (t.size() == sq.size() - 1 && _power_limbs + p->num_limbs() <= Nat::power_cache_limit) {
+			t.push_back(p);
+			_power_limbs += p->num_limbs();
+		}
+	}
+}
+
+/*! precompute the powers used to convert values of up to digits digits */
+void Nat::power_cache_reserve(size_t radix, size_t digits)
+{
+	if (radix < 2 || radix > 255 || (radix & (radix - 1)) == 0) return;
+	/* to_string divides by a power above the square root of the value */
+	size_t chunk = _chunk_digits(radix), level = 0;
+	while ((chunk << level) < digits / 2 + chunk + 2) level++;
+	_power_table sq;
+	_radix_powers(sq, radix, level);
+}
+
+/*! limbs held by the radix power cache */
+size_t Nat::power_cache_size()
+{
+	std::lock_guard<std::mutex> lock(_power_mutex);
+	return _power_limbs;
+}
+
+/*! release the radix power cache */
+void Nat::power_cache_clear()
+{
+	std::lock_guard<std::mutex> lock(_power_mutex);
+	for (_power_table &t : _power_tables) {
+		t.clear();
+	}
+	_power_limbs = 0;
+}
+
+
+/*----------------------------.
+| hex and binary conversions. |
+`----------------------------*/
+
+/*
+ * kernels converting between limbs and hex or binary digits in units of
+ * 128 bits, which are whole limbs with either limb width: 32 hex or 128
+ * binary digits, most significant first. x86 uses SSE2 or AVX2 chosen at
+ * runtime and capped by Nat::simd_level; the callers convert whatever the
+ * kernels leave with scalar loops. the kernels assume little endian limbs
+ * and the built in lower case digits, and parse letters in either case.
+ */
+
+#if NAT_X86_SIMD
+
+/*! SSE2 is part of x86-64, AVX2 is detected once */
+static int _cpu_simd_level()
+{
+	static const int level = (__builtin_cpu_init(), __builtin_cpu_supports("avx2")) ? 2 : 1;
+	return level;
+}
+
+/*! reverse the bytes of a vector */
+static inline __m128i _rev_sse2(__m128i x)
+{
+	x = _mm_shuffle_epi32(x, _MM_SHUFFLE(0, 1, 2, 3));
+	x = _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+/*! hex digit characters of nibbles */
+static inline __m128i _hex_chars_sse2(__m128i n)
+{
+	__m128i alpha = _mm_and_si128(_mm_cmpgt_epi8(n, _mm_set1_epi8(9)), _mm_set1_epi8('a' - '0' - 10));
+	return _mm_add_epi8(_mm_add_epi8(n, _mm_set1_epi8('0')), alpha);
+}
+
+/*! nibbles of hex digit characters, setting bad lanes for other characters */
+static inline __m128i _hex_values_sse2(__m128i c, __m128i &bad)
+{
+	__m128i d = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+	__m128i l = _mm_sub_epi8(_mm_or_si128(c, _mm_set1_epi8(0x20)), _mm_set1_epi8('a'));
+	__m128i is_d = _mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(9)), d);
+	__m128i is_l = _mm_cmpeq_epi8(_mm_min_epu8(l, _mm_set1_epi8(5)), l);
+	bad = _mm_or_si128(bad, _mm_andnot_si128(_mm_or_si128(is_d, is_l), _mm_set1_epi8(-1)));
+	return _mm_or_si128(_mm_and_si128(is_d, d), _mm_and_si128(is_l, _mm_add_epi8(l, _mm_set1_epi8(10))));
+}
+
+/*! write units of 16 bytes as hex ending before end */
+static void _hex_format_sse2(const unsigned char *src, size_t units, char *end)
+{
+	const __m128i mask = _mm_set1_epi8(0x0f);
+	for (size_t u = 0; u < units; u++, src += 16, end -= 32) {
+		__m128i x = _rev_sse2(_mm_loadu_si128((const __m128i*)src));
+		__m128i hi = _mm_and_si128(_mm_srli_epi16(x, 4), mask), lo = _mm_and_si128(x, mask);
+		_mm_storeu_si128((__m128i*)(end - 32), _hex_chars_sse2(_mm_unpacklo_epi8(hi, lo)));
+		_mm_storeu_si128((__m128i*)(end - 16), _hex_chars_sse2(_mm_unpackhi_epi8(hi, lo)));
+	}
+}
+
+/*! read units of 32 hex digits ending before end, false if one is not a digit */
+static bool _hex_parse_sse2(const char *end, size_t units, unsigned char *dst)
+{
+	const __m128i low = _mm_set1_epi16(0x00ff);
+	__m128i bad = _mm_setzero_si128();
+	for (size_t u = 0; u < units; u++, end -= 32, dst += 16) {
+		__m128i n0 = _hex_values_sse2(_mm_loadu_si128((const __m128i*)(end - 32)), bad);
+		__m128i n1 = _hex_values_sse2(_mm_loadu_si128((const __m128i*)(end - 16)), bad);
+		/* each 16-bit lane holds a high then a low nibble */
+		n0 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n0, low), 4), _mm_srli_epi16(n0, 8));
+		n1 = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(n1, low), 4), _mm_srli_epi16(n1, 8));
+		_mm_storeu_si128((__m128i*)dst, _rev_sse2(_mm_packus_epi16(n0, n1)));
+	}
+	return _mm_movemask_epi8(bad) == 0;
+}
+
+/*! write units of 16 bytes as binary ending before end */
+static void _bin_format_sse2(const unsigned char *src, size_t units, char *end)
+{
+	const __m128i bits = _mm_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	for (size_t u = 0; u < units; u++, src += 16) {
+		for (size_t j = 0; j < 16; j += 2, end -= 16) {
+			/* spread the two bytes over eight lanes each, the high byte first */
+			__m128i x = _mm_cvtsi32_si128(src[j + 1] | src[j] << 8);
+			x = _mm_unpacklo_epi8(x, x);
+			x = _mm_unpacklo_epi16(x, x);
+			x = _mm_unpacklo_epi32(x, x);
+			x = _mm_cmpeq_epi8(_mm_and_si128(x, bits), bits);
+			_mm_storeu_si128((__m128i*)(end - 16), _mm_sub_epi8(_mm_set1_epi8('0'), x));
+		}
+	}
+}
+
+/*! read units of 128 binary digits ending before end, false if one is not a digit */
+static bool _bin_parse_sse2(const char *end, size_t units, unsigned char *dst)
+{
+	__m128i bad = _mm_setzero_si128();
+	for (size_t u = 0; u < units * 8; u++, end -= 16, dst += 2) {
+		__m128i d = _mm_sub_epi8(_rev_sse2(_mm_loadu_si128((const __m128i*)(end - 16))), _mm_set1_epi8('0'));
+		bad = _mm_or_si128(bad, _mm_andnot_si128(_mm_cmpeq_epi8(_mm_min_epu8(d, _mm_set1_epi8(1)), d), _mm_set1_epi8(-1)));
+		unsigned short m = (unsigned short)_mm_movemask_epi8(_mm_slli_epi16(d, 7));
+		memcpy(dst, &m, 2);
+	}
+	return _mm_movemask_epi8(bad) == 0;
+}
+
+/*! reverse the bytes of a vector */
+__attribute__((target("avx2")))
+static inline __m256i _rev_avx2(__m256i x)
+{
+	const __m256i idx = _mm256_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0,
+		15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+	return _mm256_permute4x64_epi64(_mm256_shuffle_epi8(x, idx), _MM_SHUFFLE(1, 0, 3, 2));
+}
+
+/*! write pairs of units of 16 bytes as hex ending before end */
+__attribute__((target("avx2")))
+static void _hex_format_avx2(const unsigned char *src, size_t pairs, char *end)
+{
+	const __m256i mask = _mm256_set1_epi8(0x0f);
+	const __m256i lut = _mm256_setr_epi8('0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+		'a', 'b', 'c', 'd', 'e', 'f', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9',
+		'a', 'b', 'c', 'd', 'e', 'f');
+	for (size_t u = 0; u < pairs; u++, src += 32, end -= 64) {
+		__m256i x = _rev_avx2(_mm256_loadu_si256((const __m256i*)src));
+		__m256i hi = _mm256_shuffle_epi8(lut, _mm256_and_si256(_mm256_srli_epi16(x, 4), mask));
+		__m256i lo = _mm256_shuffle_epi8(lut, _mm256_and_si256(x, mask));
+		__m256i a = _mm256_unpacklo_epi8(hi, lo), b = _mm256_unpackhi_epi8(hi, lo);
+		_mm256_storeu_si256((__m256i*)(end - 64), _mm256_permute2x128_si256(a, b, 0x20));
+		_mm256_storeu_si256((__m256i*)(end - 32), _mm256_permute2x128_si256(a, b, 0x31));
+	}
+}
+
+/*! nibbles of hex digit characters, setting bad lanes for other characters */
+__attribute__((target("avx2")))
+static inline __m256i _hex_values_avx2(__m256i c, __m256i &bad)
+{
+	__m256i d = _mm256_sub_epi8(c, _mm256_set1_epi8('0'));
+	__m256i l = _mm256_sub_epi8(_mm256_or_si256(c, _mm256_set1_epi8(0x20)), _mm256_set1_epi8('a'));
+	__m256i is_d = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(9)), d);
+	__m256i is_l = _mm256_cmpeq_epi8(_mm256_min_epu8(l, _mm256_set1_epi8(5)), l);
+	bad = _mm256_or_si256(bad, _mm256_andnot_si256(_mm256_or_si256(is_d, is_l), _mm256_set1_epi8(-1)));
+	return _mm256_or_si256(_mm256_and_si256(is_d, d), _mm256_and_si256(is_l, _mm256_add_epi8(l, _mm256_set1_epi8(10))));
+}
+
+/*! read pairs of units of 32 hex digits ending before end, false if one is not a digit */
+__attribute__((target("avx2")))
+static bool _hex_parse_avx2(const char *end, size_t pairs, unsigned char *dst)
+{
+	const __m256i weights = _mm256_set1_epi16(0x0110);
+	__m256i bad = _mm256_setzero_si256();
+	for (size_t u = 0; u < pairs; u++, end -= 64, dst += 32) {
+		__m256i n0 = _hex_values_avx2(_mm256_loadu_si256((const __m256i*)(end - 64)), bad);
+		__m256i n1 = _hex_values_avx2(_mm256_loadu_si256((const __m256i*)(end - 32)), bad);
+		/* high nibble * 16 + low nibble, then undo the per lane packing */
+		__m256i b = _mm256_packus_epi16(_mm256_maddubs_epi16(n0, weights), _mm256_maddubs_epi16(n1, weights));
+		b = _mm256_permute4x64_epi64(b, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)dst, _rev_avx2(b));
+	}
+	return _mm256_movemask_epi8(bad) == 0;
+}
+
+/*! write units of 16 bytes as binary ending before end */
+__attribute__((target("avx2")))
+static void _bin_format_avx2(const unsigned char *src, size_t units, char *end)
+{
+	const __m256i spread = _mm256_setr_epi8(3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2, 2, 2, 2,
+		1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m256i bits = _mm256_setr_epi8(-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1,
+		-128, 64, 32, 16, 8, 4, 2, 1, -128, 64, 32, 16, 8, 4, 2, 1);
+	for (size_t u = 0; u < units; u++, src += 16) {
+		for (size_t j = 0; j < 16; j += 4, end -= 32) {
+			int w;
+			memcpy(&w, src + j, 4);
+			__m256i x = _mm256_shuffle_epi8(_mm256_set1_epi32(w), spread);
+			x = _mm256_cmpeq_epi8(_mm256_and_si256(x, bits), bits);
+			_mm256_storeu_si256((__m256i*)(end - 32), _mm256_sub_epi8(_mm256_set1_epi8('0'), x));
+		}
+	}
+}
+
+/*! read units of 128 binary digits ending before end, false if one is not a digit */
+__attribute__((target("avx2")))
+static bool _bin_parse_avx2(const char *end, size_t units, unsigned char *dst)
+{
+	__m256i bad = _mm256_setzero_si256();
+	for (size_t u = 0; u < units * 4; u++, end -= 32, dst += 4) {
+		__m256i d = _mm256_sub_epi8(_rev_avx2(_mm256_loadu_si256((const __m256i*)(end - 32))), _mm256_set1_epi8('0'));
+		bad = _mm256_or_si256(bad, _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(1)), d), _mm256_set1_epi8(-1)));
+		unsigned m = (unsigned)_mm256_movemask_epi8(_mm256_slli_epi16(d, 7));
+		memcpy(dst, &m, 4);
+	}
+	return _mm256_movemask_epi8(bad) == 0;
+}
+
+#endif
+
+/*! SIMD level in use, the lower of Nat::simd_level and the CPU's */
+static int _simd_level()
+{
+#if NAT_X86_SIMD
+	return std::min(Nat::simd_level, _cpu_simd_level());
+#else
+	return 0;
+#endif
+}
+
+/*!
+ * write the digits of the low whole 128-bit units of n limbs ending
+ * before end, for bpd of 1 or 4, returning the number of limbs written.
+ */
+static size_t _pow2_format_simd(const limb_t *p, size_t n, unsigned bpd, char *end)
+{
+	size_t units = n * Nat::limb_bits / 128;
+	int level = _simd_level();
+	if (level == 0 || units == 0) return 0;
+#if NAT_X86_SIMD
+	const unsigned char *src = (const unsigned char*)p;
+	if (bpd == 4) {
+		size_t pairs = level >= 2 ? units / 2 : 0;
+		if (pairs) _hex_format_avx2(src, pairs, end);
+		_hex_format_sse2(src + pairs * 32, units - pairs * 2, end - pairs * 64);
+	} else if (level >= 2) {
+		_bin_format_avx2(src, units, end);
+	} else {
+		_bin_format_sse2(src, units, end);
+	}
+#endif
+	return units * 128 / Nat::limb_bits;
+}
+
+/*!
+ * read the low whole 128-bit units of len digits for bpd of 1 or 4 into
+ * limbs, returning the number of digits read, or zero if any of them is
+ * not a digit, which the scalar loop then reports.
+ */
+static size_t _pow2_parse_simd(const char *str, size_t len, unsigned bpd, limb_t *rp)
+{
+	size_t units = len * bpd / 128;
+	int level = _simd_level();
+	if (level == 0 || units == 0) return 0;
+	bool ok = false;
+#if NAT_X86_SIMD
+	unsigned char *dst = (unsigned char*)rp;
+	if (bpd == 4) {
+		size_t pairs = level >= 2 ? units / 2 : 0;
+		ok = (pairs == 0 || _hex_parse_avx2(str + len, pairs, dst)) &&
+			_hex_parse_sse2(str + len - pairs * 64, units - pairs * 2, dst + pairs * 32);
+	} else if (level >= 2) {
+		ok = _bin_parse_avx2(str + len, units, dst);
+	} else {
+		ok = _bin_parse_sse2(str + len, units, dst);
+	}
+#endif
+	return ok ? units * 128 / bpd : 0;
+}
+
+
+/*-------------------.
+| string conversion. |
+`-------------------*/
+
+/*! low 64 bits of a value */
+static inline unsigned long long _low_u64(const Nat &val)
+{
+	unsigned long long v = 0;
+	for (size_t i = 0; i * Nat::limb_bits < 64; i++) {
+		v |= (unsigned long long)val.limb_at(i) << (i * Nat::limb_bits);
+	}
+	return v;
+}
+
+/*! number of significant bits, ignoring the width of fixed width values */
+static size_t _bit_length(const Nat &val)
+{
+	size_t n = val.num_limbs();
+	while (n > 1 && val.limbs[n - 1] == 0) n--;
+	limb_t top = val.limbs[n - 1];
+	return top ? (n - 1) * Nat::limb_bits + Nat::limb_bits - clz(top) : 0;
+}
+
+/*! bounds on a value as f * 2^e with f in [0.5, 1) */
+struct _scaled
+{
+	double f;
+	long e;
+};
+
+static inline _scaled _scale(double f, long e)
+{
+	int k;
+	f = std::frexp(f, &k);
+	return _scaled{ f, e + k };
+}
+
+static inline bool operator<(const _scaled &a, const _scaled &b)
+{
+	return a.e != b.e ? a.e < b.e : a.f < b.f;
+}
+
+/*! the top 53 bits of val, rounded down or up, as an exact double */
+static _scaled _top_bits(const Nat &val, bool up)
+{
+	size_t b = _bit_length(val);
+	if (b <= 53) {
+		return _scale(double(_low_u64(val)), 0);
+	}
+	unsigned long long t = 0;
+	for (size_t i = 0; i < 53; i++) {
+		t |= (unsigned long long)val.test_bit(b - 53 + i) << i;
+	}
+	return _scale(double(t + up), long(b - 53));
+}
+
+/*!
+ * compare val with radix^k, returning whether val >= radix^k. with k =
+ * q * chunk + r, the power is radix^r times the cached radix^(chunk * 2^i)
+ * for each set bit i of q. bounds on the power from the top bits of the
+ * factors decide the comparison unless val is within about 2^-45 of the
+ * power, in which case the factors are multiplied exactly.
+ */
+static bool _ge_radix_pow(const Nat &val, const _radix_codec &rc, size_t k)
+{
+	size_t q = k / rc.chunk, level = 0;
+	unsigned long long pr = 1;
+	for (size_t r = k % rc.chunk; r > 0; r--) pr *= rc.radix;
+	while ((q >> level) > 1) level++;
+	_power_table sq;
+	if (q) _radix_powers(sq, rc.radix, level);
+
+	_scaled lo = _scale(double(pr), 0), hi = lo;
+	int n = 0;
+	for (size_t i = 0; q >> i; i++) {
+		if ((q >> i) & 1) {
+			_scaled a = _top_bits(*sq[i], false), b = _top_bits(*sq[i], true);
+			lo = _scale(lo.f * a.f, lo.e + a.e);
+			hi = _scale(hi.f * b.f, hi.e + b.e);
+			n++;
+		}
+	}
+	/* radix^r and each product round by at most 2^-53 */
+	double err = std::ldexp(double(n + 2), -50);
+	lo = _scale(lo.f * (1 - err), lo.e);
+	hi = _scale(hi.f * (1 + err), hi.e);
+	if (_top_bits(val, true) < lo) return false;
+	if (!(_top_bits(val, false) < hi)) return true;
+
+	Nat p = Nat(limb_t(rc.radix)).pow(k % rc.chunk);
+	for (size_t i = 0; q >> i; i++) {
+		if ((q >> i) & 1) p *= *sq[i];
+	}
+	return val >= p;
+}
+
+/*!
+ * exact number of digits of val in the radix of rc. above 63 bits the
+ * logarithm is estimated from the top 64 bits, which decides its floor
+ * unless val is within rounding of a power of the radix, in which case
+ * val is compared with that power.
+ */
+static size_t _formatted_size(const Nat &val, const _radix_codec &rc)
+{
+	size_t b = _bit_length(val), n = 0;
+	if (b == 0) {
+		return 1;
+	}
+	if (rc.bpd) {
+		return (b + rc.bpd - 1) / rc.bpd;
+	}
+	if (b < 64) {
+		unsigned long long v = _low_u64(val);
+		do n++; while ((v /= rc.radix) != 0);
+		return n;
+	}
+	unsigned long long t = 0;
+	for (size_t i = 0; i < 64; i++) {
+		t |= (unsigned long long)val.test_bit(b - 64 + i) << i;
+	}
+	double x = (double(b - 64) + std::log2(double(t))) / std::log2(double(rc.radix));
+	double eps = 1e-12 * (x + 1);
+	size_t k = size_t(x - eps), kh = size_t(x + eps);
+	if (k == kh) {
+		return k + 1;
+	}
+	return _ge_radix_pow(val, rc, kh) ? kh + 1 : kh;
+}
+
+/*! write the digits of v ending before end */
+static inline void _to_string_c(unsigned long long v, const _radix_codec &rc, char *end)
+{
+	const char *digits = rc.digits.data();
+	const unsigned long long radix = rc.radix;
+	/* a constant divisor lets the compiler multiply by its reciprocal */
+	if (radix == 10) {
+		do {
+			*--end = digits[size_t(v % 10)];
+		} while ((v /= 10) != 0);
+	} else {
+		do {
+			*--end = digits[size_t(v % radix)];
+		} while ((v /= radix) != 0);
+	}
+}
+
+/*!
+ * write val, below radix^(2 * chunk * 2^level), ending before end over a
+ * run of zero digits. each level divides by radix^(chunk * 2^level) and
+ * writes the remainder and quotient halves, down to leaves of two chunks
+ * that each fit 64 bits. zero halves are left as the zero digits.
+ */
+static void _to_string_r(const Nat &val, const _power_table &sq, const _radix_codec &rc,
+	size_t level, char *end)
+{
+	if (val == 0) return;
+	Nat q, r;
+	if (level > 0) {
+		Nat::divrem(val, *sq[level], q, r);
+		_to_string_r(r, sq, rc, level - 1, end);
+		_to_string_r(q, sq, rc, level - 1, end - (size_t(rc.chunk) << level));
+	} else {
+		Nat::divrem(val, rc.leaf, q, r);
+		_to_string_c(_low_u64(r), rc, end);
+		if (q != 0) _to_string_c(_low_u64(q), rc, end - rc.chunk);
+	}
+}
+
+/*! lowest level whose halves hold n digits */
+static size_t _dc_level(const _radix_codec &rc, size_t n)
+{
+	size_t level = 0;
+	while ((size_t(2 * rc.chunk) << level) < n) level++;
+	return level;
+}
+
+/*! write the digits of n whole limbs of Bpd bits per digit, ending before out */
+template <unsigned Bpd>
+static char* _unpack_limbs(const limb_t *p, size_t n, const char *digits, char *out)
+{
+	const limb_t mask = (limb_t(1) << Bpd) - 1;
+	for (size_t j = 0; j < n; j++) {
+		limb_t l = p[j];
+		for (unsigned k = 0; k < Nat::limb_bits / Bpd; k++) {
+			*--out = digits[l & mask];
+			l >>= Bpd;
+		}
+	}
+	return out;
+}
+
+/*! write nd digits of a power of two radix from n limbs, most significant first */
+static void _to_pow2(const limb_t *p, size_t n, const _radix_codec &rc, char *out, size_t nd)
+{
+	/* locals, as stores through out could alias the codec */
+	const char *digits = rc.digits.data();
+	const unsigned bpd = rc.bpd;
+	limb_t mask = (limb_t(1) << bpd) - 1, acc = 0;
+	size_t j = 0;
+	if (Nat::limb_bits % bpd == 0) {
+		/* digits never straddle limbs, so all but the top limb unpack whole */
+		char *end = out + nd;
+		if (rc.simd) {
+			j = _pow2_format_simd(p, n - 1, bpd, end);
+			end -= j * (Nat::limb_bits / bpd);
+		}
+		switch (bpd) {
+			case 1: end = _unpack_limbs<1>(p + j, n - 1 - j, digits, end); break;
+			case 2: end = _unpack_limbs<2>(p + j, n - 1 - j, digits, end); break;
+			case 4: end = _unpack_limbs<4>(p + j, n - 1 - j, digits, end); break;
+			default: end = _unpack_limbs<8>(p + j, n - 1 - j, digits, end); break;
+		}
+		for (limb_t l = p[n - 1]; end > out; l >>= bpd) {
+			*--end = digits[l & mask];
+		}
+		return;
+	}
+	unsigned avail = 0;
+	for (size_t i = nd; i-- > 0; ) {
+		limb_t d;
+		if (avail >= bpd) {
+			d = acc & mask;
+			acc >>= bpd;
+			avail -= bpd;
+		} else {
+			/* the digit straddles a limb boundary or starts the next limb */
+			limb_t l = j < n ? p[j++] : 0;
+			d = (acc | (l << avail)) & mask;
+			acc = l >> (bpd - avail);
+			avail += Nat::limb_bits - bpd;
+		}
+		out[i] = digits[d];
+	}
+}
+
+/*! write the n = _formatted_size digits of val to out */
+static void _to_chars(const Nat &val, const _radix_codec &rc, char *out, size_t n)
+{
+	if (rc.bpd) {
+		size_t ln = std::max(size_t(1), (_bit_length(val) + Nat::limb_bits - 1) / Nat::limb_bits);
+		_to_pow2(val.limbs.data(), ln, rc, out, n);
+		return;
+	}
+	std::fill(out, out + n, rc.digits[0]);
+	if (_bit_length(val) < 64) {
+		_to_string_c(_low_u64(val), rc, out + n);
+		return;
+	}
+	size_t level = _dc_level(rc, n);
+	_power_table sq;
+	_radix_powers(sq, rc.radix, level);
+	_to_string_r(val, sq, rc, level, out + n);
+}
+
+/*! convert to string with a codec after prefix, sized exactly */
+static std::string _to_string(const Nat &val, const _radix_codec &rc, const char *prefix)
+{
+	size_t plen = strlen(prefix), n = _formatted_size(val, rc);
+	std::string s(plen + n, '\0');
+	std::copy(prefix, prefix + plen, s.begin());
+	_to_chars(val, rc, &s[plen], n);
+	return s;
+}
+
+/*! codec for a radix, throwing std::invalid_argument if it is not 2 to 36 */
+static const _radix_codec& _checked_codec(size_t radix)
+{
+	if (radix < 2 || radix > 36) {
+		throw std::invalid_argument("radix must be from 2 to 36");
+	}
+	return _builtin_codec(radix);
+}
+
+/*! convert from Nat to string */
+std::string Nat::to_string(size_t radix) const
+{
+	return _to_string(*this, _checked_codec(radix), radix == 2 ? "0b" : radix == 16 ? "0x" : "");
+}
+
+/*! convert from Nat to string with a digit alphabet */
+std::string Nat::to_string(const std::string &alphabet) const
+{
+	return _to_string(*this, _radix_codec(alphabet, false), "");
+}
+
+/*! write digits to a buffer */
+Nat::to_chars_result Nat::to_chars(char *first, char *last, size_t radix) const
+{
+	const _radix_codec &rc = _checked_codec(radix);
+	size_t n = _formatted_size(*this, rc);
+	if (size_t(last - first) < n) {
+		return to_chars_result{ last, std::errc::value_too_large };
+	}
+	_to_chars(*this, rc, first, n);
+	return to_chars_result{ first + n, std::errc() };
+}
+
+/*! number of digits written by to_chars */
+size_t Nat::formatted_size(size_t radix) const
+{
+	return _formatted_size(*this, _checked_codec(radix));
+}
+
+
+/*!
+ * schoolbook parse: each chunk of dpl digits is added to the value after
+ * multiplying it by radix^dpl, in place with single limb kernels. only
+ * the first chunk may be shorter.
+ */
+static void _from_basecase(Nat &r, const char *str, size_t len, const _radix_codec &rc)
+{
+	r.limbs.resize(len / rc.dpl + 1);
+	limb_t *rp = r.limbs.data();
+	size_t rn = 0;
+	for (size_t i = 0, cl = (len - 1) % rc.dpl + 1; i < len; i += cl, cl = rc.dpl) {
+		limb_t v = 0;
+		for (size_t j = 0; j < cl; j++) {
+			v = v * limb_t(rc.radix) + _digit(rc, str[i + j]);
+		}
+		limb_t c = Nat::_mul_1(rp, rp, rn, rc.base);
+		if (c) rp[rn++] = c;
+		c = Nat::_add_1(rp, rp, rn, v);
+		if (c) rp[rn++] = c;
+	}
+	r.limbs.resize(rn);
+	if (rn == 0) r.limbs.push_back(0);
+}
+
+/*!
+ * divide and conquer parse: the low chunk * 2^k digits, for the largest k
+ * leaving a non-empty high part, are parsed separately from the high
+ * part, which is then multiplied by radix^(chunk * 2^k) from the table
+ * and added. the halves are balanced, so the cost is that of
+ * multiplication times the depth instead of quadratic.
+ */
+static void _from_string_r(Nat &r, const char *str, size_t len, const _radix_codec &rc,
+	_power_table &sq)
+{
+	if (len <= 2 * rc.chunk || len / rc.dpl < Nat::from_string_threshold) {
+		_from_basecase(r, str, len, rc);
+		return;
+	}
+	size_t k = 0;
+	while ((size_t(2 * rc.chunk) << k) < len) k++;
+	size_t lo = size_t(rc.chunk) << k;
+	_radix_powers(sq, rc.radix, k);
+	Nat h, l;
+	_from_string_r(h, str, len - lo, rc, sq);
+	_from_string_r(l, str + len - lo, lo, rc, sq);
+	Nat::mul_into(r, h, *sq[k]);
+	r += l;
+}
+
+/*! pack digits of a power of two radix into limbs from the least significant */
+static void _from_pow2(Nat &r, const char *str, size_t len, const _radix_codec &rc)
+{
+	r.limbs.resize(0);
+	r.limbs.resize(len * rc.bpd / Nat::limb_bits + 1);
+	limb_t *rp = r.limbs.data(), acc = 0;
+	unsigned bits = 0;
+	size_t i = len;
+	if (rc.simd) {
+		size_t done = _pow2_parse_simd(str, len, rc.bpd, rp);
+		i -= done;
+		rp += done * rc.bpd / Nat::limb_bits;
+	}
+	while (i-- > 0) {
+		limb_t d = _digit(rc, str[i]);
+		acc |= d << bits;
+		bits += rc.bpd;
+		if (bits >= Nat::limb_bits) {
+			/* carry the bits of the digit that did not fit */
+			*rp++ = acc;
+			bits -= Nat::limb_bits;
+			acc = bits ? d >> (rc.bpd - bits) : 0;
+		}
+	}
+	*rp = acc;
+}
+
+/*! convert to Nat from string with a codec */
+static void _from_string(Nat &r, const char *str, size_t len, const _radix_codec &rc)
+{
+	if (rc.bpd) {
+		_from_pow2(r, str, len, rc);
+	} else if (len > 0) {
+		_power_table sq;
+		_from_string_r(r, str, len, rc, sq);
+	}
+}
+
+/*! convert to Nat from string */
+void Nat::from_string(const char *str, size_t len, size_t radix)
+{
+	/* prefixes select a radix unless the letter is a digit of radix */
+	if (len > 2 && str[0] == '0') {
+		if (str[1] == 'b' && radix <= 11) {
+			radix = 2;
+			str += 2;
+			len -= 2;
+		} else if (str[1] == 'x' && radix <= 33) {
 			radix = 16;
 			str += 2;
 			len -= 2;
@@ -826,51 +2953,135 @@ void Nat::from_string(const char *str, size_t len, size_t radix)
 	if (radix == 0) {
 		radix = 10;
 	}
-	switch (radix) {
-		case 10: {
-			for (size_t i = 0; i < len; i += 18) {
-				size_t chunklen = i + 18 < len ? 18 : len - i;
-				std::string chunk(str + i, chunklen);
-				limb2_t num = strtoull(chunk.c_str(), nullptr, 10);
-				if (chunklen == 18) {
-					*this *= tenp18;
-				} else {
-					*this *= Nat(10).pow(chunklen);
-				}
-				*this += Nat{limb_t(num), limb_t(num >> limb_bits)};
-			}
-			break;
-		}
-		case 2: {
-			for (size_t i = 0; i < len; i += 64) {
-				size_t chunklen = i + 64 < len ? 64 : len - i;
-				std::string chunk(str + i, chunklen);
-				limb2_t num = strtoull(chunk.c_str(), nullptr, 2);
-				if (chunklen == 64) {
-					*this *= twop64;
-				} else {
-					*this *= Nat(2).pow(chunklen);
-				}
-				*this += Nat{limb_t(num), limb_t(num >> limb_bits)};
-			}
-			break;
-		}
-		case 16: {
-			for (size_t i = 0; i < len; i += 16) {
-				size_t chunklen = i + 16 < len ? 16 : len - i;
-				std::string chunk(str + i, chunklen);
-				limb2_t num = strtoull(chunk.c_str(), nullptr, 16);
-				if (chunklen == 16) {
-					*this *= twop64;
-				} else {
-					*this *= Nat(16).pow(chunklen);
-				}
-				*this += Nat{limb_t(num), limb_t(num >> limb_bits)};
+	if (radix < 2 || radix > 36) {
+		throw std::invalid_argument("radix must be from 2 to 36");
+	}
+	Nat r;
+	_from_string(r, str, len, _builtin_codec(radix));
+	limbs = std::move(r.limbs);
+	_contract();
+}
+
+/*! convert to Nat from string with a digit alphabet */
+void Nat::from_string(const char *str, size_t len, const std::string &alphabet)
+{
+	Nat r;
+	_from_string(r, str, len, _radix_codec(alphabet, false));
+	limbs = std::move(r.limbs);
+	_contract();
+}
+
+
+/*---------------.
+| stream output. |
+`---------------*/
+
+/* digits formatted at a time by operator<< */
+static const size_t _stream_block = 4096;
+
+/*! block buffer writing to a stream, upper casing letters if requested */
+struct _stream_sink
+{
+	std::ostream &os;
+	bool upper;
+	char buf[_stream_block];
+
+	_stream_sink(std::ostream &os, bool upper) : os(os), upper(upper) {}
+
+	void flush(size_t n)
+	{
+		if (upper) {
+			for (size_t i = 0; i < n; i++) {
+				if (buf[i] >= 'a' && buf[i] <= 'z') buf[i] = char(buf[i] - 'a' + 'A');
 			}
-			break;
-		}
-		default: {
-			limbs.push_back(0);
 		}
+		os.write(buf, std::streamsize(n));
+	}
+};
+
+/*!
+ * write width digits of val, below radix^width, most significant first.
+ * spans wider than a block divide by radix^(chunk * 2^level) and write
+ * the quotient then the remainder, so only one block is held at a time.
+ */
+static void _stream_r(_stream_sink &out, const Nat &val, const _radix_codec &rc,
+	const _power_table &sq, size_t level, size_t width)
+{
+	size_t digits = size_t(rc.chunk) << level;
+	if (width <= _stream_block) {
+		std::fill(out.buf, out.buf + width, rc.digits[0]);
+		_to_string_r(val, sq, rc, _dc_level(rc, width), out.buf + width);
+		out.flush(width);
+	} else if (width <= digits) {
+		_stream_r(out, val, rc, sq, level - 1, width);
+	} else {
+		Nat q, r;
+		Nat::divrem(val, *sq[level], q, r);
+		_stream_r(out, q, rc, sq, level - 1, width - digits);
+		_stream_r(out, r, rc, sq, level - 1, digits);
+	}
+}
+
+/*!
+ * write nd digits of a power of two radix in blocks. each group of bpd
+ * limbs holds exactly limb_bits digits, so blocks of whole groups start
+ * and end on digit boundaries and only the top block is partial.
+ */
+static void _stream_pow2(_stream_sink &out, const Nat &val, const _radix_codec &rc, size_t nd)
+{
+	size_t k = _stream_block / Nat::limb_bits, group = rc.bpd * k, gd = k * Nat::limb_bits;
+	size_t n = std::max(size_t(1), (_bit_length(val) + Nat::limb_bits - 1) / Nat::limb_bits);
+	size_t full = (nd - 1) / gd, top = nd - full * gd;
+	const limb_t *p = val.limbs.data();
+	_to_pow2(p + full * group, n - full * group, rc, out.buf, top);
+	out.flush(top);
+	for (size_t g = full; g-- > 0; ) {
+		_to_pow2(p + g * group, group, rc, out.buf, gd);
+		out.flush(gd);
+	}
+}
+
+/*! write to a stream */
+std::ostream& operator<<(std::ostream &os, const Nat &val)
+{
+	std::ostream::sentry ok(os);
+	if (!ok) return os;
+
+	std::ios_base::fmtflags f = os.flags();
+	std::ios_base::fmtflags base = f & std::ios_base::basefield;
+	std::ios_base::fmtflags adjust = f & std::ios_base::adjustfield;
+	size_t radix = base == std::ios_base::hex ? 16 : base == std::ios_base::oct ? 8 : 10;
+	const _radix_codec &rc = _builtin_codec(radix);
+	_stream_sink out(os, (f & std::ios_base::uppercase) != 0);
+
+	const char *prefix = "";
+	if ((f & std::ios_base::showbase) && radix != 10 && val != 0) {
+		prefix = radix == 8 ? "0" : out.upper ? "0X" : "0x";
+	}
+	size_t n = _formatted_size(val, rc), len = strlen(prefix) + n;
+	size_t pad = os.width() > std::streamsize(len) ? size_t(os.width()) - len : 0;
+	os.width(0);
+
+	if (adjust != std::ios_base::left && adjust != std::ios_base::internal) {
+		for (size_t i = 0; i < pad; i++) os.put(os.fill());
+	}
+	os.write(prefix, std::streamsize(strlen(prefix)));
+	if (adjust == std::ios_base::internal) {
+		for (size_t i = 0; i < pad; i++) os.put(os.fill());
+	}
+	if (rc.bpd) {
+		_stream_pow2(out, val, rc, n);
+	} else if (n <= _stream_block) {
+		_to_chars(val, rc, out.buf, n);
+		out.flush(n);
+	} else {
+		size_t level = _dc_level(rc, n);
+		_power_table sq;
+		_radix_powers(sq, rc.radix, level);
+		_stream_r(out, val, rc, sq, level, n);
+	}
+	if (adjust == std::ios_base::left) {
+		for (size_t i = 0; i < pad; i++) os.put(os.fill());
 	}
+	return os;
 }
@@ -35,6 +35,30 @@
 #include <iostream>
 #include <algorithm>
 #include <initializer_list> 
+#include <new>
+#include <system_error>
+
+/*
+ * limb width is selected at build time with -DNAT_LIMB_BITS=64 which
+ * requires a compiler with unsigned __int128 (GCC or Clang on 64-bit)
+ */
+#ifndef NAT_LIMB_BITS
+#define NAT_LIMB_BITS 32
+#endif
+
+#if NAT_LIMB_BITS == 64 && !defined(__SIZEOF_INT128__)
+#error NAT_LIMB_BITS=64 requires unsigned __int128
+#elif NAT_LIMB_BITS != 32 && NAT_LIMB_BITS != 64
+#error NAT_LIMB_BITS must be 32 or 64
+#endif
+
+/*
+ * number of limbs stored inline before spilling to the heap, selected at
+ * build time with -DNAT_INLINE_LIMBS=n (4 holds a 128-bit or 256-bit value)
+ */
+#ifndef NAT_INLINE_LIMBS
+#define NAT_INLINE_LIMBS 4
+#endif
 
 struct Nat
 {
@@ -48,6 +72,18 @@ struct Nat
 	static const signedness _unsigned;  /* unsigned */
 	static const signedness _signed;    /* signed two's complement */
 
+#if NAT_LIMB_BITS == 64
+	/*! limb bit width and bit shift */
+	enum {
+		limb_bits = 64,
+		limb_shift = 6,
+	};
+
+	/*! limb type */
+	typedef unsigned long long limb_t;
+	typedef unsigned __int128 limb2_t;
+	typedef signed __int128 slimb2_t;
+#else
 	/*! limb bit width and bit shift */
 	enum {
 		limb_bits = 32,
@@ -58,6 +94,208 @@ struct Nat
 	typedef unsigned int limb_t;
 	typedef unsigned long long limb2_t;
 	typedef signed long long slimb2_t;
+#endif
+
+
+	/*---------------------.
+	| inline limb storage. |
+	`---------------------*/
+
+	/*!
+	 * limb container with small buffer optimisation. the first
+	 * inline_limbs limbs are stored in the object and larger sizes
+	 * spill to the heap. limbs are trivially copyable so elements are
+	 * moved with memcpy and new elements are zero filled.
+	 */
+	struct limb_vector
+	{
+		enum { inline_limbs = NAT_INLINE_LIMBS > 0 ? NAT_INLINE_LIMBS : 1 };
+
+		typedef limb_t value_type;
+		typedef limb_t* iterator;
+		typedef const limb_t* const_iterator;
+
+		limb_t *p;
+		size_t n;
+		size_t cap;
+		limb_t buf[inline_limbs];
+
+		limb_vector() : p(buf), n(0), cap(inline_limbs) {}
+
+		limb_vector(std::initializer_list<limb_t> l) : limb_vector()
+		{
+			assign(l.begin(), l.size());
+		}
+
+		limb_vector(const limb_vector &o) : limb_vector()
+		{
+			assign(o.p, o.n);
+		}
+
+		limb_vector(limb_vector &&o) noexcept : limb_vector()
+		{
+			steal(o);
+		}
+
+		~limb_vector() { if (p != buf) _free(p, cap); }
+
+		limb_vector& operator=(const limb_vector &o)
+		{
+			if (this != &o) assign(o.p, o.n);
+			return *this;
+		}
+
+		limb_vector& operator=(limb_vector &&o) noexcept
+		{
+			if (this != &o) {
+				if (p != buf) _free(p, cap);
+				p = buf;
+				cap = inline_limbs;
+				steal(o);
+			}
+			return *this;
+		}
+
+		/* take ownership of a heap buffer or copy inline limbs */
+		void steal(limb_vector &o)
+		{
+			if (o.p == o.buf) {
+				memcpy(buf, o.buf, o.n * sizeof(limb_t));
+			} else {
+				p = o.p;
+				cap = o.cap;
+				o.p = o.buf;
+				o.cap = inline_limbs;
+			}
+			n = o.n;
+			o.n = 0;
+		}
+
+		void assign(const limb_t *src, size_t len)
+		{
+			if (len > cap) grow(len, false);
+			memmove(p, src, len * sizeof(limb_t));
+			n = len;
+		}
+
+		/* grow capacity geometrically, preserving contents if requested */
+		void grow(size_t len, bool preserve)
+		{
+			size_t c = std::max(len, cap * 2);
+			limb_t *q = _alloc(c);
+			if (preserve) memcpy(q, p, n * sizeof(limb_t));
+			if (p != buf) _free(p, cap);
+			p = q;
+			cap = c;
+		}
+
+		void reserve(size_t len) { if (len > cap) grow(len, true); }
+
+		void resize(size_t len, limb_t v = 0)
+		{
+			if (len > cap) grow(len, true);
+			for (size_t i = n; i < len; i++) p[i] = v;
+			n = len;
+		}
+
+		void push_back(limb_t v)
+		{
+			if (n == cap) grow(n + 1, true);
+			p[n++] = v;
+		}
+
+		void pop_back() { n--; }
+
+		void clear() { n = 0; }
+
+		iterator insert(iterator pos, size_t count, limb_t v)
+		{
+			size_t off = pos - p;
+			if (n + count > cap) grow(n + count, true);
+			memmove(p + off + count, p + off, (n - off) * sizeof(limb_t));
+			for (size_t i = 0; i < count; i++) p[off + i] = v;
+			n += count;
+			return p + off;
+		}
+
+		iterator erase(iterator first, iterator last)
+		{
+			memmove(first, last, (p + n - last) * sizeof(limb_t));
+			n -= last - first;
+			return first;
+		}
+
+		size_t size() const { return n; }
+		size_t capacity() const { return cap; }
+		bool empty() const { return n == 0; }
+		bool is_inline() const { return p == buf; }
+
+		limb_t* data() { return p; }
+		const limb_t* data() const { return p; }
+		limb_t& operator[](size_t i) { return p[i]; }
+		const limb_t& operator[](size_t i) const { return p[i]; }
+		limb_t& back() { return p[n - 1]; }
+		const limb_t& back() const { return p[n - 1]; }
+
+		iterator begin() { return p; }
+		iterator end() { return p + n; }
+		const_iterator begin() const { return p; }
+		const_iterator end() const { return p + n; }
+
+		/*! allocate heap limbs from the thread's pool or malloc, may round up cap */
+		static limb_t* _alloc(size_t &cap);
+
+		/*! free heap limbs to the thread's pool or free */
+		static void _free(limb_t *p, size_t cap);
+	};
+
+	/*!
+	 * limb pool bucketed by power of two limb count. while a pool_scope
+	 * is active on a thread, heap limb storage is rounded up to a power of
+	 * two and freed blocks are kept on per bucket free lists for reuse,
+	 * up to max_blocks per bucket. blocks come from malloc so values may
+	 * outlive the scope; they are released to whichever pool is active
+	 * on the thread that frees them, or to free if there is none.
+	 */
+	struct limb_pool
+	{
+		enum { num_buckets = sizeof(size_t) * 8 };
+
+		limb_t *free_list[num_buckets];
+		size_t count[num_buckets];
+		size_t max_blocks;
+		size_t hits, misses;
+
+		limb_pool(size_t max_blocks = 64);
+		~limb_pool();
+
+		limb_pool(const limb_pool&) = delete;
+		limb_pool& operator=(const limb_pool&) = delete;
+
+		/*! return a block of at least cap limbs, cap is rounded up */
+		limb_t* acquire(size_t &cap);
+
+		/*! keep a block for reuse, false if the bucket is full */
+		bool release(limb_t *p, size_t cap);
+
+		/*! free all cached blocks */
+		void clear();
+	};
+
+	/*! RAII scope installing a limb pool on the current thread */
+	struct pool_scope
+	{
+		limb_pool *prev;
+
+		explicit pool_scope(limb_pool &pool);
+		~pool_scope();
+
+		pool_scope(const pool_scope&) = delete;
+		pool_scope& operator=(const pool_scope&) = delete;
+
+		/*! pool active on the current thread or nullptr */
+		static limb_pool* current();
+	};
 
 
 	/*------------------.
@@ -65,7 +303,7 @@ struct Nat
 	`------------------*/
 
 	/* limbs is a vector of words with the little end at offset 0 */
-	std::vector<limb_t> limbs;
+	limb_vector limbs;
 
 	/*! flags indicating unsigned or signed two's complement */
 	signedness s;
@@ -74,6 +312,44 @@ struct Nat
 	unsigned bits;
 
 
+	/*--------------------.
+	| tunable thresholds. |
+	`--------------------*/
+
+	/*! operand size in limbs at which multiply switches to karatsuba */
+	static size_t karatsuba_threshold;
+
+	/*! operand size in limbs at which square switches to karatsuba */
+	static size_t karatsuba_sqr_threshold;
+
+	/*! operand size in limbs at which multiply switches to toom-3 */
+	static size_t toom3_threshold;
+
+	/*! operand size in limbs at which multiply switches to toom-4 */
+	static size_t toom4_threshold;
+
+	/*! operand size in limbs at which multiply switches to the NTT */
+	static size_t ntt_threshold;
+
+	/*! divisor size in limbs at which divide switches to burnikel-ziegler */
+	static size_t bz_threshold;
+
+	/*! divisor and quotient size in limbs at which divide switches to newton reciprocal */
+	static size_t newton_threshold;
+
+	/*! operand size in limbs at which gcd switches from lehmer to half gcd */
+	static size_t hgcd_threshold;
+
+	/*! result size in limbs at which parsing switches to divide and conquer */
+	static size_t from_string_threshold;
+
+	/*! limbs the shared radix power cache may hold, beyond which powers are not kept */
+	static size_t power_cache_limit;
+
+	/*! highest SIMD level for hex and binary conversion: 0 scalar, 1 SSE2, 2 AVX2, capped by the CPU */
+	static int simd_level;
+
+
 	/*--------------.
 	| constructors. |
 	`--------------*/
@@ -97,7 +373,7 @@ struct Nat
 	Nat(const Nat &operand);
 
 	/*! move constructor */
-	Nat(const Nat&& operand) noexcept;
+	Nat(Nat&& operand) noexcept;
 
 
 	/*----------------------.
@@ -111,7 +387,7 @@ struct Nat
 	Nat& operator=(const Nat &operand);
 
 	/*! Nat move assignment operator */
-	Nat& operator=(Nat &&operand);
+	Nat& operator=(Nat &&operand) noexcept;
 
 
 	/*------------------.
@@ -128,6 +404,92 @@ struct Nat
 	void _resize(size_t n);
 
 
+	/*--------------------.
+	| limb array kernels. |
+	`--------------------*/
+
+	/* kernels operate on little endian limb arrays and do not allocate */
+
+	/*! compare limb arrays, ignoring zero big end limbs */
+	static int _cmp(const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+	/*! add equal length limb arrays returning carry */
+	static limb_t _add_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+	/*! subtract equal length limb arrays returning borrow */
+	static limb_t _sub_n(limb_t *r, const limb_t *a, const limb_t *b, size_t n);
+
+	/*! add limb arrays (an >= bn) returning carry */
+	static limb_t _add(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+	/*! subtract limb arrays (an >= bn) returning borrow */
+	static limb_t _sub(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+	/*! absolute difference (an >= bn) into an limbs, true if b > a */
+	static bool _abs_sub(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+	/*! add limb to limb array returning carry */
+	static limb_t _add_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+	/*! subtract limb from limb array returning borrow */
+	static limb_t _sub_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+	/*! multiply limb array by limb returning carry */
+	static limb_t _mul_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+	/*! multiply limb array by limb and accumulate returning carry */
+	static limb_t _addmul_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+	/*! multiply limb array by limb and subtract returning borrow */
+	static limb_t _submul_1(limb_t *r, const limb_t *a, size_t n, limb_t b);
+
+	/*! schoolbook multiply into an + bn limbs */
+	static void _mul_basecase(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+	/*! karatsuba multiply (an >= bn > (an + 1) / 2) into an + bn limbs */
+	static void _mul_karatsuba(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *ws);
+
+	/*! toom-cook multiply splitting into pa and pb parts of k limbs into an + bn limbs */
+	static void _mul_toom(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn,
+		size_t pa, size_t pb, size_t k, limb_t *ws);
+
+	/*! three prime NTT multiply into an + bn limbs (allocates transform buffers) */
+	static void _mul_ntt(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn);
+
+	/*! multiply selecting algorithm by operand size into an + bn limbs */
+	static void _mul(limb_t *r, const limb_t *a, size_t an, const limb_t *b, size_t bn, limb_t *ws);
+
+	/*! number of scratch limbs needed by _mul */
+	static size_t _mul_scratch(size_t an, size_t bn);
+
+	/*! schoolbook square into 2n limbs */
+	static void _sqr_basecase(limb_t *r, const limb_t *a, size_t n);
+
+	/*! karatsuba square into 2n limbs */
+	static void _sqr_karatsuba(limb_t *r, const limb_t *a, size_t n, limb_t *ws);
+
+	/*! square selecting algorithm by operand size into 2n limbs */
+	static void _sqr(limb_t *r, const limb_t *a, size_t n, limb_t *ws);
+
+	/*! number of scratch limbs needed by _sqr */
+	static size_t _sqr_scratch(size_t n);
+
+	/*! divide by limb d normalized by shift s with reciprocal dinv returning remainder */
+	static limb_t _div_1(limb_t *q, const limb_t *u, size_t n, limb_t d, limb_t dinv, int s);
+
+	/*! schoolbook divide un limbs by normalized dn limbs returning high quotient limb */
+	static limb_t _div_basecase(limb_t *q, limb_t *u, size_t un, const limb_t *d, size_t dn, limb_t dinv);
+
+	/*! burnikel-ziegler divide 2n limbs by normalized n limbs returning high quotient limb */
+	static limb_t _div_dc_n(limb_t *q, limb_t *u, const limb_t *d, size_t n, limb_t dinv, limb_t *ws);
+
+	/*! divide selecting algorithm by divisor size, quotient into un - dn limbs and remainder into u[0..dn) */
+	static limb_t _div(limb_t *q, limb_t *u, size_t un, const limb_t *d, size_t dn, limb_t dinv, limb_t *ws);
+
+	/*! number of scratch limbs needed by _div */
+	static size_t _div_scratch(size_t un, size_t dn);
+
+
 	/*-------------------------------.
 	| limb and bit accessor methods. |
 	`-------------------------------*/
@@ -240,12 +602,49 @@ struct Nat
 	| multply, divide and pow. |
 	`-------------------------*/
 
+	/*!
+	 * multiply workspace. it grows to the largest size requested and is
+	 * never shrunk so hot loops stop allocating once warmed up. calls
+	 * without an explicit workspace use a thread local one.
+	 */
+	struct scratch
+	{
+		limb_vector ws;
+
+		/*! return at least n limbs of workspace */
+		limb_t* get(size_t n) { if (ws.size() < n) ws.resize(n); return ws.data(); }
+	};
+
 	/*! base 2^limb_bits multiply */
-	static void mult(const Nat &multiplicand, const Nat multiplier, Nat &result);
+	static void mult(const Nat &multiplicand, const Nat &multiplier, Nat &result);
+
+	/*! base 2^limb_bits square */
+	static void sqr(const Nat &operand, Nat &result);
+
+	/*!
+	 * result = a * b with the signedness and width of a. result may
+	 * alias a or b, and is resized in place so reuses its storage.
+	 */
+	static void mul_into(Nat &result, const Nat &a, const Nat &b, scratch *ws = nullptr);
+
+	/*!
+	 * result += a * b keeping the signedness and width of result.
+	 * result may alias a or b.
+	 */
+	static void mul_add_into(Nat &result, const Nat &a, const Nat &b, scratch *ws = nullptr);
 
 	/*! base 2^limb_bits division */
 	static void divrem(const Nat &dividend, const Nat &divisor, Nat &quotient, Nat &remainder);
 
+	/*! precomputed normalization and reciprocal limb of a divisor */
+	struct Divisor;
+
+	/*! base 2^limb_bits division by a precomputed divisor */
+	static void divrem(const Nat &dividend, const Divisor &divisor, Nat &quotient, Nat &remainder);
+
+	/*! precomputed reciprocal for repeated division by one divisor */
+	struct Reciprocal;
+
 	/*! multiply */
 	Nat operator*(const Nat &operand) const;
 
@@ -255,6 +654,12 @@ struct Nat
 	/*! division remainder */
 	Nat operator%(const Nat &divisor) const;
 
+	/*! division quotient by a precomputed divisor */
+	Nat operator/(const Divisor &divisor) const;
+
+	/*! division remainder by a precomputed divisor */
+	Nat operator%(const Divisor &divisor) const;
+
 	/*! multiply equals */
 	Nat& operator*=(const Nat &operand);
 
@@ -272,10 +677,119 @@ struct Nat
 	| string conversion. |
 	`-------------------*/
 
+	/*
+	 * radices 2 to 36 use the digits 0-9 then letters, written in lower
+	 * case and read in either case. radix 2 and 16 strings are written with
+	 * a 0b or 0x prefix, which from_string accepts in any radix that does
+	 * not use b or x as a digit. alphabet overloads use the characters of
+	 * the alphabet as digits in order, so an alphabet of 58 characters
+	 * gives base58. a radix out of range, an alphabet with fewer than 2
+	 * or more than 255 digits or repeated digits, or a character that is
+	 * not a digit throw std::invalid_argument.
+	 */
+
 	/*! convert Nat to string */
 	std::string to_string(size_t radix = 10) const;
 
-	/*! convert Nat from string */
+	/*! convert Nat to string with the digits in alphabet */
+	std::string to_string(const std::string &alphabet) const;
+
+	/*! result of to_chars, as std::to_chars_result in C++17 */
+	struct to_chars_result
+	{
+		char *ptr;
+		std::errc ec;
+	};
+
+	/*!
+	 * write the digits in radix to [first, last) without a prefix or
+	 * terminator, returning the end of the digits, or last with
+	 * std::errc::value_too_large if they do not fit. the digits are
+	 * written in place without building a string.
+	 */
+	to_chars_result to_chars(char *first, char *last, size_t radix = 10) const;
+
+	/*! exact number of digits to_chars writes in radix */
+	size_t formatted_size(size_t radix = 10) const;
+
+	/*! convert Nat from string, replacing the value */
 	void from_string(const char *str, size_t len, size_t radix);
 
+	/*! convert Nat from string with the digits in alphabet, replacing the value */
+	void from_string(const char *str, size_t len, const std::string &alphabet);
+
+	/*!
+	 * conversion by divide and conquer uses radix^(c * 2^k) for each level
+	 * k, where c is the most digits that fit 63 bits. the powers are squared
+	 * once and kept in a process wide cache that is safe to share between
+	 * threads, up to power_cache_limit limbs. reserve precomputes the powers
+	 * for values of up to digits digits, so they are not computed on first
+	 * use. power of two radices need no powers.
+	 */
+	static void power_cache_reserve(size_t radix, size_t digits);
+
+	/*! limbs held by the radix power cache */
+	static size_t power_cache_size();
+
+	/*! release the radix power cache, conversions in progress are not affected */
+	static void power_cache_clear();
+
 };
+
+/*!
+ * divisor with its normalization and reciprocal precomputed for repeated
+ * division. the limbs are shifted so the top limb has the high bit set
+ * and dinv is the Moller-Granlund reciprocal of the top limb, or of the
+ * top two limbs for multi-limb divisors, so quotient limbs are found
+ * with multiplies rather than hardware divides.
+ */
+struct Nat::Divisor
+{
+	/*! normalized divisor limbs (empty for a zero divisor) */
+	limb_vector d;
+
+	/*! reciprocal of the top normalized limbs */
+	limb_t dinv;
+
+	/*! normalization shift in bits */
+	int shift;
+
+	/*! precompute normalization and reciprocal of divisor */
+	explicit Divisor(const Nat &divisor);
+};
+
+/*!
+ * reciprocal of a divisor for repeated division. the divisor is shifted
+ * to n limbs with the high bit set and v is computed by Newton iteration
+ * to within a few units of floor(B^2n / d) where B = 2^limb_bits. each
+ * block of n quotient limbs then costs two multiplies plus correction
+ * steps, so constructing once and dividing many times skips the
+ * reciprocal computation.
+ */
+struct Nat::Reciprocal
+{
+	/*! normalized divisor */
+	Nat d;
+
+	/*! approximate floor(B^2n / d) */
+	Nat v;
+
+	/*! number of limbs in the normalized divisor (0 for a zero divisor) */
+	size_t n;
+
+	/*! normalization shift in bits */
+	int shift;
+
+	/*! compute the reciprocal of divisor */
+	explicit Reciprocal(const Nat &divisor);
+
+	/*! divide by the divisor, with the same contract as Nat::divrem */
+	void divrem(const Nat &dividend, Nat &quotient, Nat &remainder) const;
+};
+
+/*!
+ * write to a stream in the radix of the basefield flags, decimal, hex or
+ * octal, honouring showbase, uppercase, width, fill and adjustfield. the
+ * digits are formatted and written in blocks rather than as one string.
+ */
+std::ostream& operator<<(std::ostream &os, const Nat &val);
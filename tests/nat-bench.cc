@@ -0,0 +1,226 @@
+/*
+ * nat-bench.cc
+ *
+ * simple benchmarks for unsigned natural number implementation
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cstdio>
+#include <cassert>
+#include <chrono>
+#include <functional>
+
+#include "nat.h"
+#include "nat-fixed.h"
+#include "nat-expr.h"
+#include "nat-mod.h"
+#include "nat-ct.h"
+#include "nat-num.h"
+
+static unsigned long long rand_state = 0x2545f4914f6cdd1dULL;
+
+/* xorshift64 limb generator so runs are reproducible */
+static Nat::limb_t rand_limb()
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 7;
+	rand_state ^= rand_state << 17;
+	return Nat::limb_t(rand_state);
+}
+
+/* random natural number of the given bit width */
+static Nat rand_bits(size_t bits)
+{
+	Nat r;
+	r.limbs.resize((bits + Nat::limb_bits - 1) / Nat::limb_bits);
+	for (auto &l : r.limbs) {
+		l = rand_limb();
+	}
+	r.set_bit(bits - 1);
+	return r & ((Nat(1) << bits) - 1);
+}
+
+/* run fn in growing batches for at least 100ms and print the mean time per call */
+static void bench(const char *name, size_t bits, std::function<void()> fn)
+{
+	typedef std::chrono::steady_clock clock;
+	size_t iters = 0, batch = 1;
+	auto t0 = clock::now(), t1 = t0;
+	do {
+		for (size_t i = 0; i < batch; i++) {
+			fn();
+		}
+		iters += batch;
+		batch <<= 1;
+		t1 = clock::now();
+	} while (t1 - t0 < std::chrono::milliseconds(100));
+	double ns = std::chrono::duration<double,std::nano>(t1 - t0).count() / iters;
+	printf("%-12s %8zu %14.1f\n", name, bits, ns);
+}
+
+/* compare FixedNat with Nat of the same fixed width */
+template <unsigned Bits>
+static void bench_fixed()
+{
+	Nat a = rand_bits(Bits - 1), b = rand_bits(Bits - 1);
+	a.bits = b.bits = Bits;
+	Nat r = a;
+	FixedNat<Bits> fa(a), fb(b), fr(a);
+	bench("nat_add", Bits, [&]() { r = r + b; });
+	bench("fixed_add", Bits, [&]() { fr = fr + fb; });
+	bench("nat_mul", Bits, [&]() { r = r * a + b; });
+	bench("fixed_mul", Bits, [&]() { fr = fr * fa + fb; });
+	bench("nat_shift", Bits, [&]() { r = (r << 3) ^ b; });
+	bench("fixed_shift", Bits, [&]() { fr = (fr << 3) ^ fb; });
+	assert(fr.limbs[0] != 0 || r.limb_at(0) != 0);
+}
+
+int main(int argc, const char **argv)
+{
+	printf("limb_bits=%d\n", int(Nat::limb_bits));
+	printf("%-12s %8s %14s\n", "operation", "bits", "ns/op");
+
+	for (size_t bits : { 256, 1024, 4096, 16384, 65536, 262144 }) {
+		Nat a = rand_bits(bits), b = rand_bits(bits), c = rand_bits(bits * 2), r;
+		bench("mult", bits, [&]() { r = a * b; });
+		bench("sqr", bits, [&]() { Nat::sqr(a, r); });
+		bench("divrem", bits, [&]() { Nat q; Nat::divrem(c, a, q, r); });
+		Nat::Reciprocal ra(a);
+		bench("recip_divrem", bits, [&]() { Nat q; ra.divrem(c, q, r); });
+		bench("add", bits, [&]() { r = a + b; });
+		bench("shift", bits, [&]() { r = a << 17; });
+		if (bits <= 65536) {
+			std::string s = a.to_string(10);
+			bench("to_string", bits, [&]() { s = a.to_string(10); });
+			std::vector<char> buf(a.formatted_size(10));
+			bench("to_chars", bits, [&]() { a.to_chars(buf.data(), buf.data() + buf.size(), 10); });
+			bench("from_string", bits, [&]() { r.from_string(s.c_str(), s.size(), 10); });
+			std::string h = a.to_string(16);
+			bench("to_hex", bits, [&]() { h = a.to_string(16); });
+			bench("from_hex", bits, [&]() { r.from_string(h.c_str(), h.size(), 16); });
+		}
+	}
+
+	for (size_t bits : { 32, 64, 128, 1024 }) {
+		Nat a = rand_bits(4096), b = rand_bits(bits), q, r;
+		Nat::Divisor db(b);
+		bench("div_nat", bits, [&]() { Nat::divrem(a, b, q, r); });
+		bench("div_divisor", bits, [&]() { Nat::divrem(a, db, q, r); });
+	}
+
+	for (size_t bits : { 1024, 2048, 4096 }) {
+		Nat m = rand_bits(bits) | Nat(1), a = rand_bits(bits - 1), e = rand_bits(bits), r;
+		MontgomeryContext ctx(m);
+		Nat am = ctx.to_mont(a);
+		bench("mont_mul", bits, [&]() { r = ctx.mul(am, am); });
+		bench("mulmod", bits, [&]() { r = a * a % m; });
+		bench("modpow", bits, [&]() { r = modpow(a, e, ctx); });
+		BarrettContext bctx(m << 1);
+		Nat x = a * e;
+		bench("mod_even", bits, [&]() { r = x % bctx.m; });
+		bench("barrett", bits, [&]() { r = bctx.reduce(x); });
+		bench("modpow_even", bits, [&]() { r = modpow(a, e, bctx); });
+	}
+
+	for (size_t bits : { 1024, 2048 }) {
+		size_t n = bits / Nat::limb_bits;
+		Nat m = rand_bits(bits) | Nat(1), a = rand_bits(bits - 1);
+		MontgomeryContext ctx(m);
+		ConstTimeNat ca(a, n), e1(Nat(1), n), en((Nat(1) << bits) - 1, n), r(n);
+		bench("ct_modpow_e1", bits, [&]() { r = modpow(ca, e1, ctx); });
+		bench("ct_modpow_en", bits, [&]() { r = modpow(ca, en, ctx); });
+	}
+
+	for (size_t bits : { 1024, 16384, 65536, 262144 }) {
+		Nat a = rand_bits(bits), b = rand_bits(bits), g, s, t;
+		bench("gcd", bits, [&]() { g = gcd(a, b); });
+		bench("xgcd", bits, [&]() { xgcd(a, b, g, s, t); });
+		if (bits <= 16384) {
+			bench("gcd_euclid", bits, [&]() {
+				Nat u = a, v = b;
+				while (v != 0) { Nat r = u % v; u = std::move(v); v = std::move(r); }
+				g = u;
+			});
+		}
+	}
+
+	for (size_t bits : { 1024, 16384, 262144 }) {
+		Nat a = rand_bits(bits) | Nat(1), r;
+		bench("isqrt", bits, [&]() { r = isqrt(a); });
+		bench("iroot_3", bits, [&]() { r = iroot(a, 3); });
+		bench("perfect_pow", bits, [&]() { r = is_perfect_power(a); });
+	}
+
+	for (size_t bits : { 512, 1024, 2048, 4096 }) {
+		Nat a = rand_bits(bits) | Nat(1), p = next_prime(a), r;
+		bench("is_prime", bits, [&]() { r = is_probable_prime(p); });
+		bench("is_prime_mr", bits, [&]() { r = is_probable_prime(p, 1, false); });
+		bench("is_composite", bits, [&]() { r = is_probable_prime(a); a += Nat(2); });
+		if (bits <= 2048) {
+			bench("next_prime", bits, [&]() { r = next_prime(a); a += Nat(1) << (bits / 2); });
+		}
+	}
+
+	for (size_t n : { 10000, 100000, 1000000 }) {
+		Nat r;
+		bench("factorial", n, [&]() { r = factorial(n); });
+		if (n <= 100000) {
+			bench("factorial_seq", n, [&]() {
+				r = 1;
+				for (size_t i = 2; i <= n; i++) r *= Nat(Nat::limb_t(i));
+			});
+		}
+		bench("binomial", n, [&]() { r = binomial(n, n / 2); });
+		bench("primorial", n, [&]() { r = primorial(n); });
+	}
+
+	for (size_t bits : { 256, 4096 }) {
+		Nat a = rand_bits(bits), b = rand_bits(bits), c = rand_bits(bits), r;
+		bench("muladd", bits, [&]() { r = a * b + c; });
+		bench("fused_muladd", bits, [&]() { assign(r, lazy(a) * b + c); });
+		bench("shlor", bits, [&]() { r = (a << 67) | c; });
+		bench("fused_shlor", bits, [&]() { assign(r, (lazy(a) << 67) | c); });
+		bench("andnot", bits, [&]() { r = a & ~b; });
+		bench("fused_andnot", bits, [&]() { assign(r, lazy(a) & ~lazy(b)); });
+		bench("addshl", bits, [&]() { r = a + (b << 67); });
+		bench("fused_addshl", bits, [&]() { assign(r, a + (lazy(b) << 67)); });
+	}
+
+	for (size_t bits : { 512, 4096 }) {
+		Nat a = rand_bits(bits), b = rand_bits(bits / 2), q, r;
+		auto batch = [&]() {
+			Nat::divrem(a * a, b, q, r);
+			std::string s = r.to_string();
+			r = b.pow(3) + Nat(s);
+		};
+		bench("temps", bits, batch);
+		Nat::limb_pool pool;
+		Nat::pool_scope scope(pool);
+		bench("pooled_temps", bits, batch);
+	}
+
+	bench_fixed<128>();
+	bench_fixed<256>();
+	bench_fixed<512>();
+
+	return 0;
+}
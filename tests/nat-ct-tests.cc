@@ -0,0 +1,117 @@
+/*
+ * nat-ct-tests.cc
+ *
+ * test cases for constant time arithmetic
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <stdexcept>
+
+#include "nat-ct.h"
+#include "nat-test-rand.h"
+
+/* arithmetic and comparisons against Nat */
+static void test_ops(size_t n)
+{
+	Nat w = Nat(1) << (n * Nat::limb_bits);
+	Nat a = rand_nat_carry(n), b = rand_nat_carry(n);
+	ConstTimeNat ca(a, n), cb(b, n), r(n);
+
+	assert(ConstTimeNat::add(r, ca, cb) == ((a + b) >= w));
+	assert(r.num_limbs() == n && r.to_nat() == (a + b) % w);
+	assert(ConstTimeNat::sub(r, ca, cb) == (a < b));
+	assert(r.to_nat() == (a + w - b) % w);
+	assert((ca + cb - cb) == ca);
+
+	assert(ConstTimeNat::cmp(ca, cb) == (a < b ? -1 : a > b ? 1 : 0));
+	assert(ConstTimeNat::cmp(ca, ca) == 0);
+	assert((ca < cb) == (a < b) && (ca == cb) == (a == b));
+
+	ConstTimeNat x(ca), y(cb);
+	ConstTimeNat::cswap(0, x, y);
+	assert(x == ca && y == cb);
+	ConstTimeNat::cswap(1, x, y);
+	assert(x == cb && y == ca);
+	ConstTimeNat::select(r, 1, ca, cb);
+	assert(r == ca);
+	ConstTimeNat::select(r, 0, ca, cb);
+	assert(r == cb);
+}
+
+int main(int argc, char const *argv[])
+{
+	/* values keep their limb count, including leading zero limbs */
+	ConstTimeNat z(Nat(0), 4);
+	assert(z.num_limbs() == 4 && z.to_nat() == 0);
+	z -= ConstTimeNat(Nat(1), 4);
+	assert(z.to_nat() == (Nat(1) << (4 * Nat::limb_bits)) - 1);
+	assert(ConstTimeNat(Nat(1) << (4 * Nat::limb_bits), 4).to_nat() == 0);
+
+	for (size_t n = 1; n < 20; n++) {
+		for (size_t i = 0; i < 8; i++) {
+			test_ops(n);
+		}
+	}
+
+	/* masks */
+	assert(ConstTimeNat::_mask(0) == 0);
+	assert(ConstTimeNat::_mask(1) == Nat::limb_t(-1));
+
+	/* ladder against sliding window modpow, exponents with leading zero limbs */
+	MontgomeryContext c97(Nat(97));
+	assert(modpow(ConstTimeNat(Nat(5), 1), ConstTimeNat(Nat(3), 2), c97).to_nat() == 125 % 97);
+	assert(modpow(ConstTimeNat(Nat(5), 1), ConstTimeNat(Nat(0), 2), c97).to_nat() == 1);
+	assert(modpow(ConstTimeNat(Nat(0), 1), ConstTimeNat(Nat(0), 1), c97).to_nat() == 1);
+	assert(modpow(ConstTimeNat(Nat(7), 1), ConstTimeNat(Nat(9), 1),
+		MontgomeryContext(Nat(1))).to_nat() == 0);
+	for (size_t n = 1; n < 40; n += (n < 8 ? 1 : 5)) {
+		Nat m = rand_nat_carry(n) | (Nat(1) << (n * Nat::limb_bits - 1));
+		m.set_bit(0);
+		MontgomeryContext ctx(m);
+		for (size_t en : { size_t(1), n, n + 2 }) {
+			Nat b = rand_nat_carry(n), e = rand_nat_carry(en);
+			ConstTimeNat r = modpow(ConstTimeNat(b, n), ConstTimeNat(e, en), ctx);
+			assert(r.num_limbs() == n);
+			assert(r.to_nat() == modpow(b, e, ctx));
+		}
+	}
+
+	/* mismatched limb counts are rejected */
+	bool thrown = false;
+	try {
+		ConstTimeNat r(2);
+		ConstTimeNat::add(r, ConstTimeNat(2), ConstTimeNat(3));
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+	thrown = false;
+	try {
+		modpow(ConstTimeNat(Nat(5), 2), ConstTimeNat(Nat(3), 1), c97);
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	return 0;
+}
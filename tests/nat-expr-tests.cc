@@ -0,0 +1,101 @@
+/*
+ * nat-expr-tests.cc
+ *
+ * test cases for fused natural number expressions
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+
+#include "nat-expr.h"
+#include "nat-test-rand.h"
+
+/* both value and width must match the unfused operators */
+static bool same(const Nat &a, const Nat &b)
+{
+	return a == b && a.bits == b.bits && a.s.is_signed == b.s.is_signed;
+}
+
+/* compare each fused expression with the unfused operators */
+static void test_expr(const Nat &a, const Nat &b, const Nat &c, size_t k)
+{
+	Nat r;
+	assert(same(lazy(a) * b + c, a * b + c));
+	assert(same(assign(r, lazy(a) * b + c), a * b + c));
+	assert(same((lazy(a) << k) | c, (a << k) | c));
+	assert(same(assign(r, (lazy(a) << k) | c), (a << k) | c));
+	assert(same(lazy(a) & ~lazy(b), a & ~b));
+	assert(same(assign(r, lazy(a) & ~lazy(b)), a & ~b));
+	assert(same(a + (lazy(b) << k), a + (b << k)));
+	assert(same(assign(r, a + (lazy(b) << k)), a + (b << k)));
+
+	/* destination aliasing each operand */
+	Nat x;
+	x = a; assert(same(assign(x, lazy(x) * b + c), a * b + c));
+	x = b; assert(same(assign(x, lazy(a) * x + c), a * b + c));
+	x = c; assert(same(assign(x, lazy(a) * b + x), a * b + c));
+	x = a; assert(same(assign(x, lazy(x) * x + x), a * a + a));
+	x = a; assert(same(assign(x, (lazy(x) << k) | c), (a << k) | c));
+	x = c; assert(same(assign(x, (lazy(a) << k) | x), (a << k) | c));
+	x = a; assert(same(assign(x, (lazy(x) << k) | x), (a << k) | a));
+	x = a; assert(same(assign(x, lazy(x) & ~lazy(b)), a & ~b));
+	x = b; assert(same(assign(x, lazy(a) & ~lazy(x)), a & ~b));
+	x = a; assert(same(assign(x, x + (lazy(b) << k)), a + (b << k)));
+	x = b; assert(same(assign(x, a + (lazy(x) << k)), a + (b << k)));
+	x = a; assert(same(assign(x, x + (lazy(x) << k)), a + (a << k)));
+}
+
+int main(int argc, char const *argv[])
+{
+	/* variable width operands across the karatsuba threshold */
+	for (size_t m : { 1, 2, 7, 40, 90 }) {
+		for (size_t n : { 1, 3, 40, 100 }) {
+			for (size_t k : { 0, 1, 31, 32, 33, 100 }) {
+				test_expr(rand_nat(m), rand_nat(n), rand_nat((m + n) / 2 + 1), k);
+			}
+		}
+	}
+
+	/* fixed width operands including mixed widths and signedness */
+	for (unsigned bits : { 45, 64, 100, 256 }) {
+		for (size_t k : { 0, 3, 40, 250 }) {
+			size_t n = (bits + Nat::limb_bits - 1) / Nat::limb_bits;
+			test_expr(rand_nat(n, bits), rand_nat(n, bits), rand_nat(n, bits), k);
+			test_expr(rand_nat(n, bits), rand_nat(n + 1, bits + 40), rand_nat(n + 2), k);
+			test_expr(rand_nat(n + 3), rand_nat(n, bits), rand_nat(n, bits), k);
+			test_expr(rand_nat(n, bits, Nat::_signed), rand_nat(n, bits, Nat::_signed),
+				rand_nat(n, bits, Nat::_signed), k);
+		}
+	}
+
+	/* assignment into a destination with capacity reuses its storage */
+	Nat a = rand_nat(20), b = rand_nat(20), c = rand_nat(30), r = rand_nat(64);
+	const Nat::limb_t *p = r.limbs.data();
+	assign(r, lazy(a) * b + c);
+	assign(r, (lazy(a) << 77) | c);
+	assign(r, lazy(c) & ~lazy(a));
+	assign(r, c + (lazy(a) << 300));
+	assert(r.limbs.data() == p);
+	assert(r == c + (a << 300));
+
+	return 0;
+}
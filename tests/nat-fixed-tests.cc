@@ -0,0 +1,127 @@
+/*
+ * nat-fixed-tests.cc
+ *
+ * test cases for compile time fixed width natural numbers
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+
+#include "nat-fixed.h"
+#include "nat-test-rand.h"
+
+template <unsigned Bits, bool Signed>
+static FixedNat<Bits,Signed> rand_fixed()
+{
+	FixedNat<Bits,Signed> r;
+	for (auto &l : r.limbs) {
+		l = rand_limb();
+	}
+	/* sprinkle in all zero and all one limbs to exercise carries */
+	r.limbs[rand_limb() % r.num_limbs] = (rand_limb() & 1) ? 0 : Nat::limb_t(-1);
+	r._mask();
+	return r;
+}
+
+/* check every operator against Nat with the same width and signedness */
+template <unsigned Bits, bool Signed>
+static void test_fixed()
+{
+	typedef FixedNat<Bits,Signed> F;
+
+	for (size_t iter = 0; iter < 200; iter++) {
+		F a = rand_fixed<Bits,Signed>(), b = rand_fixed<Bits,Signed>();
+		Nat na = a.to_nat(), nb = b.to_nat();
+		assert(F(na) == a);
+		assert(na.bits == Bits && na.s.is_signed == Signed);
+
+		assert((a + b).to_nat() == na + nb);
+		assert((a - b).to_nat() == na - nb);
+		assert((a * b).to_nat() == na * nb);
+		assert((a * a).to_nat() == na * na);
+		assert((a & b).to_nat() == (na & nb));
+		assert((a | b).to_nat() == (na | nb));
+		assert((a ^ b).to_nat() == (na ^ nb));
+		assert((~a).to_nat() == ~na);
+		assert((-a).to_nat() == -na);
+		assert((a < b) == (na < nb));
+		assert((a <= b) == (na <= nb));
+		assert((a > b) == (na > nb));
+		assert((a >= b) == (na >= nb));
+		assert((a == b) == (na == nb));
+		assert(a.pow(5).to_nat() == na.pow(5));
+
+		for (size_t shamt : { size_t(0), size_t(1), size_t(Nat::limb_bits - 1), size_t(Nat::limb_bits),
+			size_t(Nat::limb_bits + 3), size_t(Bits - 1) })
+		{
+			assert((a << shamt).to_nat() == na << shamt);
+			assert((a >> shamt).to_nat() == na >> shamt);
+		}
+
+		if (!Signed && b != F()) {
+			F q = a / b, r = a % b;
+			assert(q * b + r == a && r < b);
+		}
+	}
+}
+
+int main(int argc, char const *argv[])
+{
+	/* widths below, at and across limb boundaries */
+	test_fixed<1,false>();
+	test_fixed<31,false>();
+	test_fixed<32,false>();
+	test_fixed<45,true>();
+	test_fixed<64,false>();
+	test_fixed<64,true>();
+	test_fixed<100,true>();
+	test_fixed<128,false>();
+	test_fixed<128,true>();
+	test_fixed<200,false>();
+	test_fixed<256,false>();
+	test_fixed<256,true>();
+	test_fixed<512,false>();
+
+	/* wraparound */
+	typedef FixedNat<128> u128;
+	typedef FixedNat<128,true> s128;
+	assert(u128(0) - u128(1) == ~u128(0));
+	assert(~u128(0) + u128(1) == u128(0));
+	assert((u128(1) << 127) * u128(2) == u128(0));
+	assert((u128(1) << 128) == u128(0));
+	assert((~u128(0) >> 127) == u128(1));
+	assert(u128("0xffffffffffffffffffffffffffffffff") == ~u128(0));
+	assert(u128(3).pow(81).to_string() == "103144121322099306484875023187381681347");
+
+	/* signed ordering and arithmetic shift */
+	assert(-s128(1) < s128(0));
+	assert(-s128(2) < -s128(1));
+	assert((-s128(256) >> 4) == -s128(16));
+	assert((-s128(1) >> 200) == -s128(1));
+	assert((s128(1) << 127) < s128(0));
+
+	/* conversions truncate and zero extend */
+	assert(FixedNat<64>((Nat(1) << 64) + 5) == FixedNat<64>(5));
+	assert(FixedNat<256>(Nat(7)).to_nat() == Nat(7, Nat::_unsigned, 256));
+
+	return 0;
+}
@@ -0,0 +1,160 @@
+/*
+ * nat-mod-tests.cc
+ *
+ * test cases for modular arithmetic
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <stdexcept>
+
+#include "nat-mod.h"
+#include "nat-test-rand.h"
+
+/* reference square and multiply with division after every step */
+static Nat modpow_ref(Nat b, const Nat &e, const Nat &m)
+{
+	Nat r = Nat(1) % m;
+	b = b % m;
+	for (size_t i = 0; i < e.num_bits(); i++) {
+		if (e.test_bit(i)) r = (r * b) % m;
+		b = (b * b) % m;
+	}
+	return r;
+}
+
+/* Montgomery kernels agree with each other and with the definition */
+static void test_kernels(const MontgomeryContext &ctx)
+{
+	size_t n = ctx.n;
+	Nat a = rand_nat(n) % ctx.m, b = rand_nat(n) % ctx.m;
+	std::vector<Nat::limb_t> ap(n), bp(n), r1(n), r2(n), r3(n), ws(ctx._scratch());
+	std::copy(a.limbs.begin(), a.limbs.end(), ap.begin());
+	std::copy(b.limbs.begin(), b.limbs.end(), bp.begin());
+	ctx._mul_cios(r1.data(), ap.data(), bp.data(), ws.data());
+	ctx._mul_fios(r2.data(), ap.data(), bp.data(), ws.data());
+	Nat::_mul(ws.data(), ap.data(), n, bp.data(), n, ws.data() + 2 * n);
+	ctx._redc(r3.data(), ws.data());
+	assert(r1 == r2 && r2 == r3);
+	assert(ctx.mul(a, b) == ctx.from_mont(a * b % ctx.m));
+	assert(ctx.sqr(a) == ctx.mul(a, a));
+	assert(ctx.from_mont(ctx.to_mont(a)) == a);
+	assert(ctx.to_mont(a * b) == ctx.mul(ctx.to_mont(a), ctx.to_mont(b)));
+}
+
+/* Barrett reduction agrees with divrem for all sizes up to and past 2n limbs */
+static void test_barrett(const Nat &m)
+{
+	BarrettContext ctx(m);
+	size_t n = ctx.n;
+	for (size_t xn = 0; xn <= 2 * n + 2; xn++) {
+		Nat x = rand_nat(xn);
+		assert(ctx.reduce(x) == x % m);
+	}
+	Nat top = (Nat(1) << (2 * n * Nat::limb_bits)) - 1;
+	assert(ctx.reduce(top) == top % m);
+	assert(ctx.reduce(m) == 0);
+	Nat a = rand_nat(n) % m, b = rand_nat(n) % m;
+	assert(ctx.mulmod(a, b) == a * b % m);
+	assert(ctx.mulmod(m - 1, m - 1) == (m - 1) * (m - 1) % m);
+	Nat e = rand_nat(n);
+	assert(modpow(a + m, e, ctx) == modpow_ref(a, e, m));
+}
+
+int main(int argc, char const *argv[])
+{
+	/* small modulus against hand computed values */
+	MontgomeryContext c97(Nat(97));
+	assert(modpow(Nat(5), Nat(3), c97) == 125 % 97);
+	assert(modpow(Nat(2), Nat(96), c97) == 1);
+	assert(modpow(Nat(0), Nat(0), c97) == 1);
+	assert(modpow(Nat(0), Nat(5), c97) == 0);
+	assert(modpow(Nat(1000), Nat(1), c97) == 1000 % 97);
+	assert(modpow(Nat(12), Nat(34), MontgomeryContext(Nat(1))) == 0);
+
+	/* fixed width exponents are scanned from their top set bit */
+	assert(modpow(Nat(3), Nat(0, Nat::_unsigned, 64), MontgomeryContext(Nat(7))) == 1);
+	assert(modpow(Nat(5), Nat(3, Nat::_unsigned, 64), c97) == 125 % 97);
+	assert(modpow(Nat(2), Nat(96, Nat::_unsigned, 256), c97) == 1);
+
+	/* fermat on mersenne primes across the kernel size switch */
+	for (size_t p : { 61, 89, 127, 521, 607, 1279, 2203, 4423 }) {
+		Nat m = (Nat(1) << p) - 1;
+		MontgomeryContext ctx(m);
+		assert(modpow(Nat(3), m - 1, ctx) == 1);
+		assert(modpow(Nat(3), m, ctx) == 3);
+	}
+
+	/* random odd moduli against the reference */
+	for (size_t n = 1; n < 80; n += (n < 8 ? 1 : 7)) {
+		Nat m = rand_nat(n);
+		m.set_bit(0);
+		MontgomeryContext ctx(m);
+		test_kernels(ctx);
+		for (size_t en : { size_t(1), size_t(3), n }) {
+			Nat b = rand_nat(n + 1), e = rand_nat(en);
+			assert(modpow(b, e, ctx) == modpow_ref(b, e, m));
+		}
+	}
+
+	/* Barrett on general, even, power of two and power of ten moduli,
+	 * with truncated products and with the division kernel */
+	size_t div_threshold = BarrettContext::div_threshold;
+	for (size_t t : { size_t(-1), size_t(1) }) {
+		BarrettContext::div_threshold = t;
+		for (size_t n = 1; n < 80; n += (n < 8 ? 1 : 7)) {
+			test_barrett(rand_nat(n) | Nat(1) << (n * Nat::limb_bits - 1));
+			test_barrett(rand_nat(n) << 1);
+			test_barrett(Nat(1) << ((n - 1) * Nat::limb_bits));
+			test_barrett(Nat(10).pow(n * 9));
+			Nat m = rand_nat(n);
+			m.set_bit(0);
+			assert(modpow(m - 2, m + 5, BarrettContext(m)) ==
+				modpow(m - 2, m + 5, MontgomeryContext(m)));
+		}
+	}
+	BarrettContext::div_threshold = div_threshold;
+	assert(modpow(Nat(12), Nat(34), BarrettContext(Nat(1))) == 0);
+	assert(modpow(Nat(7), Nat(0), BarrettContext(Nat(10))) == 1);
+	assert(modpow(Nat(3), Nat(0, Nat::_unsigned, 64), BarrettContext(Nat(10))) == 1);
+	assert(modpow(Nat(3), Nat(5, Nat::_unsigned, 128), BarrettContext(Nat(10))) == 3);
+
+	/* even modulus is rejected */
+	bool thrown = false;
+	try {
+		MontgomeryContext ctx(Nat(100));
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	/* zero modulus is rejected */
+	thrown = false;
+	try {
+		BarrettContext ctx(Nat(0));
+	} catch (const std::invalid_argument &) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	return 0;
+}
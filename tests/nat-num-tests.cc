@@ -0,0 +1,286 @@
+/*
+ * nat-num-tests.cc
+ *
+ * test cases for number theoretic functions
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <cassert>
+#include <stdexcept>
+
+#include "nat-num.h"
+#include "nat-test-rand.h"
+
+/* reference euclid */
+static Nat gcd_ref(Nat a, Nat b)
+{
+	while (b != 0) {
+		Nat r = a % b;
+		a = b;
+		b = r;
+	}
+	return a;
+}
+
+/* gcd, bezout identity and coefficient bounds */
+static void test_gcd(const Nat &a, const Nat &b)
+{
+	Nat g = gcd(a, b), s, t, h;
+	assert(g == gcd_ref(a, b));
+	assert(gcd(b, a) == g);
+	bool pos = xgcd(a, b, h, s, t);
+	assert(h == g);
+	assert(pos ? a * s - b * t == g : b * t - a * s == g);
+	if (a != 0 && b != 0) {
+		assert(s <= b / g && t <= a / g);
+	}
+}
+
+/* r = iroot(a, k) satisfies r^k <= a < (r + 1)^k */
+static void test_root(const Nat &a, size_t k)
+{
+	Nat r = k == 2 ? isqrt(a) : iroot(a, k);
+	assert(r.pow(k) <= a && a < (r + Nat(1)).pow(k));
+}
+
+/* reference primality by trial division */
+static bool is_prime_ref(uint64_t n)
+{
+	if (n < 2) return false;
+	for (uint64_t d = 2; d * d <= n; d++) {
+		if (n % d == 0) return false;
+	}
+	return true;
+}
+
+/* from 64-bit value */
+static Nat nat64(uint64_t x)
+{
+	return (Nat(Nat::limb_t(x >> 32)) << 32) | Nat(Nat::limb_t(x & 0xffffffff));
+}
+
+int main(int argc, char const *argv[])
+{
+	/* small values */
+	assert(gcd(Nat(0), Nat(0)) == 0);
+	assert(gcd(Nat(0), Nat(7)) == 7);
+	assert(gcd(Nat(12), Nat(18)) == 6);
+	assert(gcd(Nat(17), Nat(5)) == 1);
+	for (unsigned a = 0; a < 40; a++) {
+		for (unsigned b = 0; b < 40; b++) {
+			test_gcd(Nat(a), Nat(b));
+		}
+	}
+
+	/* fibonacci neighbours have the longest quotient sequences */
+	Nat f0(0), f1(1);
+	for (size_t i = 0; i < 3000; i++) {
+		Nat f2 = f0 + f1;
+		f0 = std::move(f1);
+		f1 = std::move(f2);
+	}
+	test_gcd(f1, f0);
+
+	/* random operands with a common factor, equal and unequal sizes,
+	 * with lehmer alone and with half gcd from a small threshold */
+	size_t hgcd_threshold = Nat::hgcd_threshold;
+	for (size_t th : { size_t(-1), size_t(2) }) {
+		Nat::hgcd_threshold = th;
+		for (size_t n = 1; n < 120; n += (n < 8 ? 1 : 13)) {
+			for (size_t m : { size_t(1), n / 2 + 1, n }) {
+				Nat c = rand_nat(m / 2 + 1);
+				test_gcd(rand_nat(n) * c, rand_nat(m) * c);
+				test_gcd(rand_nat(n), rand_nat(m));
+			}
+		}
+		Nat a = rand_nat(40), b = a + Nat(1);
+		test_gcd(a, b);
+		test_gcd(a, a);
+		test_gcd(a << 300, a << 200);
+	}
+	Nat::hgcd_threshold = hgcd_threshold;
+
+	/* modular inverse */
+	assert(modinv(Nat(3), Nat(7)) == 5);
+	assert(modinv(Nat(10), Nat(1)) == 0);
+	assert(modinv(Nat(1), Nat(2)) == 1);
+	for (size_t n = 1; n < 40; n += 3) {
+		Nat m = rand_nat(n) | Nat(1), a = rand_nat(n + 1);
+		if (gcd(a, m) != 1) continue;
+		Nat x = modinv(a, m);
+		assert(x < m && a * x % m == Nat(1) % m);
+	}
+	Nat p = (Nat(1) << 521) - 1;
+	assert(modinv(Nat(2), p) == (p + 1) / 2);
+
+	bool thrown = false;
+	try {
+		modinv(Nat(6), Nat(9));
+	} catch (const std::domain_error &) {
+		thrown = true;
+	}
+	assert(thrown);
+	thrown = false;
+	try {
+		modinv(Nat(6), Nat(0));
+	} catch (const std::domain_error &) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	/* integer roots of small values, powers and their neighbours */
+	for (unsigned a = 0; a < 300; a++) {
+		for (size_t k = 1; k < 10; k++) {
+			test_root(Nat(a), k);
+		}
+	}
+	assert(isqrt(Nat(0xffffffffU)) == 0xffffU);
+	assert(isqrt((Nat(1) << 128) - 1) == (Nat(1) << 64) - 1);
+	assert(iroot(Nat(1000), 3) == 10);
+	assert(iroot(Nat(1) << 1000, 1000) == 2);
+	assert(iroot(Nat(5), 1u << 30) == 1);
+	for (size_t n = 1; n < 200; n += (n < 8 ? 1 : 17)) {
+		for (size_t k : { 2, 3, 5, 7, 64, 100 }) {
+			Nat a = rand_nat(n), r = iroot(a, k), p = r.pow(k);
+			test_root(a, k);
+			test_root(p, k);
+			if (p > 0) test_root(p - 1, k);
+			test_root(p + 1, k);
+		}
+	}
+	thrown = false;
+	try {
+		iroot(Nat(8), 0);
+	} catch (const std::domain_error &) {
+		thrown = true;
+	}
+	assert(thrown);
+
+	/* perfect powers */
+	assert(is_perfect_power(Nat(0)));
+	assert(is_perfect_power(Nat(1)));
+	assert(!is_perfect_power(Nat(2)));
+	assert(is_perfect_power(Nat(4)));
+	assert(!is_perfect_power(Nat(12)));
+	for (unsigned a = 2; a < 2000; a++) {
+		bool pp = false;
+		for (unsigned b = 2; b * b <= a; b++) {
+			unsigned x = b * b;
+			while (x < a) x *= b;
+			pp = pp || x == a;
+		}
+		assert(is_perfect_power(Nat(a)) == pp);
+	}
+	for (size_t k : { 2, 3, 5, 6, 7, 13, 31 }) {
+		Nat b = rand_nat(3) | Nat(3), p = b.pow(k);
+		assert(is_perfect_power(p));
+		assert(is_perfect_power(p << k));
+		assert(!is_perfect_power(p + 1));
+	}
+	assert(is_perfect_power(Nat(1) << 997));
+	assert(!is_perfect_power((Nat(1) << 521) - 1));
+
+	/* probable primes against trial division, below and above 2^32 */
+	for (uint64_t n = 0; n < 20000; n++) {
+		assert(is_probable_prime(nat64(n)) == is_prime_ref(n));
+	}
+	for (uint64_t n = (uint64_t(1) << 36) - 1000; n < (uint64_t(1) << 36) + 1000; n++) {
+		assert(is_probable_prime(nat64(n)) == is_prime_ref(n));
+	}
+
+	/* mersenne primes and composites, a square and a Carmichael number
+	 * (6k+1)(12k+1)(18k+1) that is a strong pseudoprime to base 2 */
+	for (size_t e : { 61, 89, 107, 127, 521, 607 }) {
+		assert(is_probable_prime((Nat(1) << e) - 1));
+		assert(is_probable_prime((Nat(1) << e) - 1, 8, false));
+	}
+	for (size_t e : { 67, 101, 256 }) {
+		assert(!is_probable_prime((Nat(1) << e) - 1));
+	}
+	assert(!is_probable_prime((Nat(1) << 128) + 1));
+	assert(!is_probable_prime(((Nat(1) << 61) - 1).pow(2)));
+	Nat psp = nat64(27278026129ULL);
+	assert(is_probable_prime(psp, 0, false));
+	assert(!is_probable_prime(psp, 8, false));
+	assert(!is_probable_prime(psp));
+
+	/* next prime, with no probable prime skipped */
+	assert(next_prime(Nat(0)) == 2);
+	assert(next_prime(Nat(2)) == 3);
+	assert(next_prime(Nat(13)) == 17);
+	assert(next_prime(nat64(4294967291ULL)) == nat64(4294967311ULL));
+	assert(next_prime(Nat(1) << 64) == (Nat(1) << 64) + 13);
+	assert(next_prime(Nat(1) << 128) == (Nat(1) << 128) + 51);
+	for (size_t n : { 2, 8, 16 }) {
+		Nat x = rand_nat(n), p = next_prime(x);
+		assert(p > x && is_probable_prime(p));
+		for (Nat y = x + Nat(1); y < p; y += Nat(1)) {
+			assert(!is_probable_prime(y));
+		}
+	}
+
+	/* products against sequential multiplication */
+	assert(product(std::vector<Nat>()) == 1);
+	std::vector<Nat> v;
+	Nat seq(1);
+	for (size_t i = 0; i < 37; i++) {
+		v.push_back(rand_nat(i % 5 + 1));
+		seq *= v.back();
+		assert(product(v) == seq);
+	}
+	unsigned small[] = { 3, 5, 7, 11 };
+	assert(product(small, small + 4) == 1155);
+
+	Nat f(1);
+	for (size_t n = 0; n < 1200; n++) {
+		if (n > 0) f *= Nat(Nat::limb_t(n));
+		if (n < 300 || n % 97 == 0) assert(factorial(n) == f);
+	}
+	assert(factorial(20) == Nat("2432902008176640000"));
+
+	/* binomials against pascal's triangle, and both methods on large n */
+	std::vector<Nat> row(1, Nat(1));
+	for (size_t n = 0; n < 80; n++) {
+		for (size_t k = 0; k <= n + 1; k++) {
+			assert(binomial(n, k) == (k <= n ? row[k] : Nat(0)));
+		}
+		std::vector<Nat> next(n + 2, Nat(1));
+		for (size_t k = 1; k <= n; k++) next[k] = row[k - 1] + row[k];
+		row = std::move(next);
+	}
+	for (size_t k : { 3, 40, 300, 1000, 1700 }) {
+		Nat b = binomial(2000, k);
+		assert(b == factorial(2000) / (factorial(k) * factorial(2000 - k)));
+	}
+	assert(binomial(100000, 3) == Nat(100000) * Nat(99999) * Nat(99998) / Nat(6));
+
+	/* primorials against a product of probable primes */
+	assert(primorial(0) == 1 && primorial(1) == 1 && primorial(2) == 2);
+	assert(primorial(30) == Nat("6469693230"));
+	Nat pr(1);
+	for (Nat::limb_t n = 2; n < 3000; n++) {
+		if (is_probable_prime(Nat(n))) pr *= Nat(n);
+	}
+	assert(primorial(2999) == pr);
+
+	return 0;
+}
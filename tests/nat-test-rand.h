@@ -0,0 +1,65 @@
+/*
+ * nat-test-rand.h
+ *
+ * random values for randomized tests
+ *
+ * Copyright (C) 2017, Michael Clark <michaeljclark@mac.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "nat.h"
+
+/* deterministic xorshift generator for randomized tests */
+static unsigned long long rand_state = 0x9e3779b97f4a7c15ULL;
+
+static inline Nat::limb_t rand_limb()
+{
+	rand_state ^= rand_state << 13;
+	rand_state ^= rand_state >> 7;
+	rand_state ^= rand_state << 17;
+	return Nat::limb_t(rand_state);
+}
+
+/* random value of n limbs, with an optional width and signedness */
+static inline Nat rand_nat(size_t n, unsigned bits = 0, Nat::signedness s = Nat::_unsigned)
+{
+	Nat r(0, s, bits);
+	r._resize(n);
+	for (size_t i = 0; i < n; i++) {
+		r.limbs[i] = rand_limb();
+	}
+	r._contract();
+	return r;
+}
+
+/* random value of n limbs with all zero and all one limbs to exercise carries */
+static inline Nat rand_nat_carry(size_t n)
+{
+	Nat r;
+	r._resize(n);
+	for (size_t i = 0; i < n; i++) {
+		Nat::limb_t k = rand_limb() % 4;
+		r.limbs[i] = k == 0 ? 0 : k == 1 ? Nat::limb_t(-1) : rand_limb();
+	}
+	r._contract();
+	return r;
+}
@@ -25,8 +25,48 @@
  */
 
 #include <cassert>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
 
 #include "nat.h"
+#include "nat-test-rand.h"
+
+/* digits of a in radix by repeated single limb division */
+static std::string to_radix_ref(Nat a, size_t radix, const std::string &digits)
+{
+	std::string s;
+	do {
+		Nat q, r;
+		Nat::divrem(a, Nat(Nat::limb_t(radix)), q, r);
+		s.push_back(digits[r.limb_at(0)]);
+		a = q;
+	} while (a != 0);
+	return std::string(s.rbegin(), s.rend());
+}
+
+/* construct from 32-bit words independent of the limb width */
+static Nat nat32(std::initializer_list<unsigned> l, Nat::signedness s = Nat::_unsigned, unsigned bits = 0)
+{
+	Nat r(0, s, bits);
+	size_t i = 0;
+	for (unsigned w : l) {
+		r |= Nat(w) << (32 * i++);
+	}
+	return r;
+}
+
+/* multiply using only the schoolbook loop as a reference */
+static Nat mult_basecase(const Nat &a, const Nat &b)
+{
+	size_t karatsuba_threshold = Nat::karatsuba_threshold;
+	Nat::karatsuba_threshold = -1;
+	Nat c = b; /* distinct copy so squares do not take the squaring path */
+	Nat r = a * c;
+	Nat::karatsuba_threshold = karatsuba_threshold;
+	return r;
+}
 
 int main(int argc, char const *argv[])
 {
@@ -85,6 +125,20 @@ int main(int argc, char const *argv[])
 	assert(b8.limb_at(0) == 0b101);
 	assert(b8.limb_at(1) == 0b101);
 
+	/* test inline limb storage spilling to the heap and back */
+	size_t spill = Nat::limb_bits * Nat::limb_vector::inline_limbs * 2;
+	Nat v1(3);
+	assert(v1.limbs.is_inline());
+	Nat v2 = v1 << spill;
+	assert(!v2.limbs.is_inline());
+	assert(v2 >> spill == v1);
+	Nat v3 = std::move(v2);
+	assert(v3 == v1 << spill);
+	v2 = v1;
+	assert(v2 == v1 && v2.limbs.is_inline());
+	v3 = std::move(v1);
+	assert(v3 == v2);
+
 	/* test equals */
 	assert((Nat{2,3} == Nat{2,3,0}));
 	assert((Nat{2,3,0} == Nat{2,3}));
@@ -151,25 +205,168 @@ int main(int argc, char const *argv[])
 
 	/* test multiplication */
 	Nat b12 = Nat(2147483648) * Nat(2147483648);
-	assert(b12.num_limbs() == 2);
-	assert(b12.limb_at(0) == 0);
-	assert(b12.limb_at(1) == 1073741824);
+	assert(b12 == nat32({0, 1073741824}));
 	Nat b13 = b12 * b12;
-	assert(b13.num_limbs() == 4);
-	assert(b13.limb_at(0) == 0);
-	assert(b13.limb_at(1) == 0);
-	assert(b13.limb_at(2) == 0);
-	assert(b13.limb_at(3) == 268435456);
+	assert(b13 == nat32({0, 0, 0, 268435456}));
 	Nat b14 = Nat(2147483647) * Nat(2147483647);
-	assert(b14.num_limbs() == 2);
-	assert(b14.limb_at(0) == 1);
-	assert(b14.limb_at(1) == 1073741823);
+	assert(b14 == nat32({1, 1073741823}));
 	Nat b15 = b14 * b14;
-	assert(b15.num_limbs() == 4);
-	assert(b15.limb_at(0) == 1);
-	assert(b15.limb_at(1) == 2147483646);
-	assert(b15.limb_at(2) == 2147483649);
-	assert(b15.limb_at(3) == 268435455);
+	assert(b15 == nat32({1, 2147483646, 2147483649, 268435455}));
+
+	/* karatsuba multiplication */
+	for (size_t m : { 32, 33, 63, 64, 65, 100, 257, 600 }) {
+		for (size_t n : { 1, 16, 32, 33, 50, 64, 130, 257, 600 }) {
+			Nat x = rand_nat(m), y = rand_nat(n);
+			assert(x * y == mult_basecase(x, y));
+			assert(y * x == mult_basecase(x, y));
+		}
+	}
+
+	/* karatsuba multiplication with zero limbs and truncation */
+	Nat b16 = (Nat(1) << 4000) - 1;
+	assert(b16 * b16 == mult_basecase(b16, b16));
+	assert((b16 << 2000) * (b16 << 1000) == mult_basecase(b16, b16) << 3000);
+	Nat b16w = rand_nat(100), b16x = rand_nat(100);
+	b16w.bits = b16x.bits = 3000 + 7;
+	b16w._contract();
+	b16x._contract();
+	assert(b16w * b16x == (mult_basecase(b16w, b16x) & ((Nat(1) << 3007) - 1)));
+
+	/* toom-cook multiplication including unbalanced splits, using small
+	 * thresholds so every split is exercised on modest operand sizes */
+	size_t karatsuba_threshold = Nat::karatsuba_threshold;
+	size_t karatsuba_sqr_threshold = Nat::karatsuba_sqr_threshold;
+	size_t toom3_threshold = Nat::toom3_threshold;
+	size_t toom4_threshold = Nat::toom4_threshold;
+	Nat::karatsuba_threshold = 4;
+	Nat::toom3_threshold = 6;
+	Nat::toom4_threshold = 10;
+	for (size_t m = 6; m < 80; m += 3) {
+		for (size_t n = 6; n <= m; n++) {
+			Nat x = rand_nat(m), y = (n & 1) ? rand_nat(n) : (Nat(1) << (n * Nat::limb_bits)) - 1;
+			assert(x * y == mult_basecase(x, y));
+		}
+	}
+	Nat::karatsuba_threshold = karatsuba_threshold;
+	Nat::toom3_threshold = toom3_threshold;
+	Nat::toom4_threshold = toom4_threshold;
+	for (size_t n : { 600, 750, 1000, 1500 }) {
+		Nat x = rand_nat(1500), y = rand_nat(n);
+		assert(x * y == mult_basecase(x, y));
+	}
+
+	/* NTT multiplication */
+	size_t ntt_threshold = Nat::ntt_threshold;
+	Nat::ntt_threshold = 1;
+	for (size_t m = 1; m < 40; m += 3) {
+		for (size_t n = 1; n <= m; n++) {
+			Nat x = rand_nat(m), y = (n & 1) ? rand_nat(n) : (Nat(1) << (n * Nat::limb_bits)) - 1;
+			assert(x * y == mult_basecase(x, y));
+		}
+	}
+	Nat::ntt_threshold = ntt_threshold;
+	Nat b16n = (Nat(1) << 200000) - 1, b16m = rand_nat(4000);
+	assert(b16n * b16n == (Nat(1) << 400000) - (Nat(1) << 200001) + 1);
+	assert(b16n * b16m == (b16m << 200000) - b16m);
+
+	/* squaring */
+	for (size_t n = 1; n < 120; n += 7) {
+		Nat x = rand_nat(n), y = (Nat(1) << (n * Nat::limb_bits)) - 1, z;
+		Nat::sqr(x, z);
+		assert(z == mult_basecase(x, x));
+		assert(x * x == mult_basecase(x, x));
+		assert(y * y == mult_basecase(y, y));
+	}
+	Nat::karatsuba_threshold = 4;
+	Nat::karatsuba_sqr_threshold = 4;
+	Nat::toom3_threshold = 6;
+	Nat::toom4_threshold = 10;
+	for (size_t n = 4; n < 100; n++) {
+		Nat x = (n & 1) ? rand_nat(n) : (Nat(1) << (n * Nat::limb_bits)) - 1, z;
+		Nat::sqr(x, z);
+		assert(z == mult_basecase(x, x));
+	}
+	Nat::ntt_threshold = 1;
+	for (size_t n = 1; n < 20; n++) {
+		Nat x = rand_nat(n), z;
+		Nat::sqr(x, z);
+		assert(z == mult_basecase(x, x));
+	}
+	Nat::karatsuba_threshold = karatsuba_threshold;
+	Nat::karatsuba_sqr_threshold = karatsuba_sqr_threshold;
+	Nat::toom3_threshold = toom3_threshold;
+	Nat::toom4_threshold = toom4_threshold;
+	Nat::ntt_threshold = ntt_threshold;
+	Nat b16s(0x7fffffff, Nat::_unsigned, 45), b16t(0, Nat::_unsigned, 45);
+	Nat::sqr(b16s, b16t);
+	assert(b16t == ((Nat(0x7fffffff) * Nat(0x7fffffff)) & ((Nat(1) << 45) - 1)));
+
+	/* in place multiply and multiply add including aliased operands */
+	Nat::scratch ws;
+	for (size_t m : { 1, 3, 40, 300 }) {
+		for (size_t n : { 1, 2, 40, 150 }) {
+			Nat x = rand_nat(m), y = rand_nat(n), r, p = mult_basecase(x, y);
+			Nat::mul_into(r, x, y, &ws);
+			assert(r == p);
+			r = x;
+			Nat::mul_into(r, r, y, &ws);
+			assert(r == p);
+			r = y;
+			Nat::mul_into(r, x, r);
+			assert(r == p);
+			r = x;
+			Nat::mul_into(r, r, r, &ws);
+			assert(r == mult_basecase(x, x));
+			r = y;
+			Nat::mul_add_into(r, x, y, &ws);
+			assert(r == p + y);
+			r = x;
+			Nat::mul_add_into(r, r, r);
+			assert(r == mult_basecase(x, x) + x);
+		}
+	}
+
+	/* horner accumulation at fixed width reuses storage after warm up */
+	Nat h(0, Nat::_unsigned, 64 * Nat::limb_bits), hx = rand_nat(64), hc = rand_nat(60);
+	Nat hr = h;
+	const Nat::limb_t *hp = nullptr, *wp = nullptr;
+	for (size_t i = 0; i < 8; i++) {
+		Nat::mul_into(h, h, hx, &ws);
+		h += hc;
+		hr = hr * hx + hc;
+		if (i == 1) {
+			hp = h.limbs.data();
+			wp = ws.ws.data();
+		}
+	}
+	assert(h == hr);
+	assert(h.limbs.data() == hp && ws.ws.data() == wp);
+
+	/* pooled limb storage recycles temporaries within a scope */
+	Nat escaped, escaped_x;
+	{
+		Nat::limb_pool pool;
+		Nat::pool_scope scope(pool);
+		assert(Nat::pool_scope::current() == &pool);
+		Nat x = rand_nat(50), y = rand_nat(20), q, r;
+		for (size_t i = 0; i < 10; i++) {
+			Nat::divrem(x * x, y, q, r);
+			assert(q * y + r == x * x);
+			assert(Nat(x.to_string()) == x);
+			assert(x.pow(3) == x * x * x);
+		}
+		assert(pool.hits > pool.misses);
+		{
+			Nat::limb_pool inner(1);
+			Nat::pool_scope inner_scope(inner);
+			assert(Nat::pool_scope::current() == &inner);
+			escaped = x << 1000;
+			escaped_x = x;
+		}
+		assert(Nat::pool_scope::current() == &pool);
+	}
+	assert(Nat::pool_scope::current() == nullptr);
+	assert(escaped == escaped_x << 1000);
 
 	/* test subtraction */
 	assert((Nat{3,3,3} - Nat{1,1,1} == Nat{2,2,2}));
@@ -181,11 +378,120 @@ int main(int argc, char const *argv[])
 
 	/* test division */
 	Nat b19 = b15 / b14;
-	assert(b19.num_limbs() == 2);
-	assert(b19.limb_at(0) == 1);
-	assert(b19.limb_at(1) == 1073741823);
+	assert(b19 == nat32({1, 1073741823}));
 	assert(b19.to_string() == "4611686014132420609");
 
+	/* division with a normalized divisor (top bit of the divisor set) */
+	for (size_t m : { 2, 3, 5, 9 }) {
+		for (size_t n : { 1, 2, 4 }) {
+			Nat x = rand_nat(m + n), y = rand_nat(n);
+			y.set_bit(n * Nat::limb_bits - 1);
+			Nat q, r;
+			Nat::divrem(x, y, q, r);
+			assert(q * y + r == x && r < y);
+		}
+	}
+
+	/* burnikel-ziegler division checked against schoolbook, using a small
+	 * threshold so the recursion and block splits run on modest sizes */
+	size_t bz_threshold = Nat::bz_threshold;
+	for (size_t n = 2; n < 40; n += 3) {
+		for (size_t m : { n, n + 1, n + 7, 2 * n, 3 * n + 5, 5 * n - 1 }) {
+			Nat y = (n % 3 == 0) ? (Nat(1) << (n * Nat::limb_bits)) - 1
+				: (n % 3 == 1) ? (Nat(1) << (n * Nat::limb_bits - 1)) + rand_nat(1) : rand_nat(n);
+			Nat x = (m & 1) ? rand_nat(m) : rand_nat(m - n + 1) * y + (y - 1);
+			Nat q1, r1, q2, r2;
+			Nat::bz_threshold = size_t(-1);
+			Nat::divrem(x, y, q1, r1);
+			Nat::bz_threshold = 2;
+			Nat::divrem(x, y, q2, r2);
+			assert(q1 == q2 && r1 == r2);
+			assert(q2 * y + r2 == x && r2 < y);
+			Nat::divrem(x, y, x, y);
+			assert(x == q1 && y == r1);
+		}
+	}
+	Nat::bz_threshold = bz_threshold;
+	for (size_t n : { 100, 300, 700 }) {
+		Nat x = rand_nat(2000), y = rand_nat(n), q, r;
+		Nat::divrem(x, y, q, r);
+		assert(q * y + r == x && r < y);
+	}
+
+	/* precomputed divisors checked against divrem, including the 3/2
+	 * division edge where the top dividend limbs equal the divisor's */
+	for (size_t n = 1; n < 12; n++) {
+		for (int k = 0; k < 4; k++) {
+			Nat y = k == 0 ? rand_nat(n) : k == 1 ? (Nat(1) << (n * Nat::limb_bits)) - 1
+				: k == 2 ? Nat(1) << (n * Nat::limb_bits - 1) : rand_nat(n) >> 5;
+			Nat::Divisor dy(y);
+			for (size_t m : { n, n + 1, 3 * n + 2 }) {
+				Nat x = rand_nat(m), q1, r1, q2, r2;
+				Nat::divrem(x, y, q1, r1);
+				Nat::divrem(x, dy, q2, r2);
+				assert(q1 == q2 && r1 == r2);
+				assert(q1 * y + r1 == x && r1 < y);
+				assert(x / dy == q1 && x % dy == r1);
+				Nat::divrem(x, dy, x, r2);
+				assert(x == q1 && r2 == r1);
+			}
+		}
+		if (n >= 2) {
+			Nat y = rand_nat(n), q, r;
+			y.set_bit(n * Nat::limb_bits - 1);
+			Nat x = (y >> ((n - 2) * Nat::limb_bits)) << ((n + 3) * Nat::limb_bits);
+			Nat::divrem(x, Nat::Divisor(y), q, r);
+			assert(q * y + r == x && r < y);
+		}
+	}
+	{
+		Nat x = rand_nat(5), q, r;
+		Nat::divrem(x, Nat::Divisor(Nat(0)), q, r);
+		assert(q == 0 && r == x);
+		assert(x / Nat::Divisor(Nat(1)) == x && x % Nat::Divisor(Nat(1)) == 0);
+	}
+
+	/* newton reciprocal division checked against burnikel-ziegler, using a
+	 * small threshold so the newton recursion runs on modest sizes */
+	size_t newton_threshold = Nat::newton_threshold;
+	Nat::newton_threshold = 4;
+	for (size_t n : { 1, 2, 3, 4, 5, 8, 13, 21, 34, 55 }) {
+		Nat y = (n % 3 == 0) ? (Nat(1) << (n * Nat::limb_bits)) - 1
+			: (n % 3 == 1) ? (Nat(1) << (n * Nat::limb_bits - 1)) : rand_nat(n);
+		Nat::Reciprocal recip(y);
+		for (size_t m : { n, n + 4, 2 * n, 2 * n + 3, 7 * n + 1 }) {
+			Nat x = (m & 1) ? rand_nat(m) : rand_nat(m - n + 1) * y + (y - 1);
+			Nat q1, r1, q2, r2;
+			size_t t = Nat::newton_threshold;
+			Nat::newton_threshold = size_t(-1);
+			Nat::divrem(x, y, q1, r1);
+			Nat::newton_threshold = t;
+			recip.divrem(x, q2, r2);
+			assert(q1 == q2 && r1 == r2);
+			Nat::divrem(x, y, q2, r2);
+			assert(q1 == q2 && r1 == r2);
+			recip.divrem(x, x, r2);
+			assert(x == q1 && r1 == r2);
+		}
+	}
+	/* thresholds below the base case of the newton recursion */
+	for (size_t t : { 1, 2 }) {
+		Nat::newton_threshold = t;
+		for (Nat y : { (Nat(1) << 100) + 12345, rand_nat(9) }) {
+			Nat x = (Nat(1) << 400) + rand_nat(11), q1, r1, q2, r2;
+			Nat::divrem(x, y, q1, r1);
+			assert(q1 * y + r1 == x && r1 < y);
+			Nat::Reciprocal(y).divrem(x, q2, r2);
+			assert(q1 == q2 && r1 == r2);
+		}
+	}
+	Nat::newton_threshold = newton_threshold;
+	{
+		Nat q, r;
+		Nat::Reciprocal(Nat(0)).divrem(Nat(7), q, r);
+		assert(q == 0 && r == 7);
+	}
+
 	/* test set and test bit */
 	Nat b20;
 	b20.set_bit(64);
@@ -204,21 +510,25 @@ int main(int argc, char const *argv[])
 	/* binary string formatting */
 	assert((Nat{0b101}).to_string(2) == "0b101");
 	assert((Nat{0b111100001111}).to_string(2) == "0b111100001111");
-	assert((Nat{0xff00ff,0xff}).to_string(2) == "0b1111111100000000111111110000000011111111");
+	assert(nat32({0xff00ff,0xff}).to_string(2) == "0b1111111100000000111111110000000011111111");
 
 	/* hex string formatting */
 	assert((Nat{0x1}).to_string(16) == "0x1");
 	assert((Nat{0x7f}).to_string(16) == "0x7f");
 	assert((Nat{0x3ff}).to_string(16) == "0x3ff");
-	assert((Nat{0xffffffff,1}).to_string(16) == "0x1ffffffff");
-	assert((Nat{0xffffffff,0x80}).to_string(16) == "0x80ffffffff");
-	assert((Nat{0xffffffff,0x400}).to_string(16) == "0x400ffffffff");
-	assert((Nat{0x80000000,0x80000000}).to_string(16) == "0x8000000080000000");
+	assert(nat32({0xffffffff,1}).to_string(16) == "0x1ffffffff");
+	assert(nat32({0xffffffff,0x80}).to_string(16) == "0x80ffffffff");
+	assert(nat32({0xffffffff,0x400}).to_string(16) == "0x400ffffffff");
+	assert(nat32({0x80000000,0x80000000}).to_string(16) == "0x8000000080000000");
 
 	/* pow */
 	assert(Nat(71).pow(0) == 1);
 	assert(Nat(71).pow(1) == 71);
 	assert(Nat(71).pow(17).to_string() == "29606831241262271996845213307591");
+	assert(Nat(3, Nat::_unsigned, 64).pow(41) == nat32({0x7b5fb863, 0xfa2a1cf6}));
+	Nat b20p = 1;
+	for (int i = 0; i < 1000; i++) b20p *= 12345;
+	assert(Nat(12345).pow(1000) == b20p);
 
 	/* from string */
 	assert(Nat("71").to_string() == "71");
@@ -229,28 +539,234 @@ int main(int argc, char const *argv[])
 	assert(Nat("0b11110000111100001111000011110000").to_string(2) == "0b11110000111100001111000011110000");
 	assert(Nat("3249094308290873429032409832424398902348094329803249083249089802349809430822903").to_string()
 		== "3249094308290873429032409832424398902348094329803249083249089802349809430822903");
+	assert(Nat("0xDEADbeef") == Nat(0xdeadbeef));
+	Nat b21 = 12345;
+	b21.from_string("678", 3, 10);
+	assert(b21 == 678);
+
+	/* decimal parsing by schoolbook and by divide and conquer */
+	size_t from_string_threshold = Nat::from_string_threshold;
+	for (size_t th : { size_t(-1), size_t(1) }) {
+		Nat::from_string_threshold = th;
+		for (size_t n : { 1, 2, 3, 7, 31, 64, 200, 1000 }) {
+			Nat x = rand_nat(n);
+			std::string s = x.to_string();
+			assert(Nat(s) == x);
+			assert(Nat("000" + s) == x);
+			assert(Nat(x.to_string(16)) == x);
+			assert(Nat(x.to_string(2)) == x);
+		}
+		assert(Nat(std::string(1000, '9')) == Nat(10).pow(1000) - 1);
+		assert(Nat("1" + std::string(1151, '0')) == Nat(10).pow(1151));
+	}
+	Nat::from_string_threshold = from_string_threshold;
+
+	/* radix power cache */
+	size_t power_cache_limit = Nat::power_cache_limit;
+	Nat b22 = rand_nat(500);
+	std::string b22s = b22.to_string();
+	Nat::power_cache_clear();
+	assert(Nat::power_cache_size() == 0);
+	Nat::power_cache_reserve(10, b22s.size());
+	size_t b22n = Nat::power_cache_size();
+	assert(b22n > 0);
+	assert(b22.to_string() == b22s);
+	assert(Nat(b22s) == b22);
+	assert(Nat::power_cache_size() == b22n);
+	Nat::power_cache_clear();
+	Nat::power_cache_limit = 0;
+	assert(b22.to_string() == b22s);
+	assert(Nat(b22s) == b22);
+	assert(Nat::power_cache_size() == 0);
+	Nat::power_cache_limit = power_cache_limit;
+
+	/* radix 2 to 36, by schoolbook and by divide and conquer */
+	std::string digits36 = "0123456789abcdefghijklmnopqrstuvwxyz";
+	for (size_t th : { size_t(-1), size_t(1) }) {
+		Nat::from_string_threshold = th;
+		for (size_t radix = 2; radix <= 36; radix++) {
+			std::string prefix = radix == 2 ? "0b" : radix == 16 ? "0x" : "";
+			for (size_t n : { 1, 3, 40 }) {
+				Nat x = rand_nat(n);
+				std::string s = to_radix_ref(x, radix, digits36);
+				assert(x.to_string(radix) == prefix + s);
+				assert(Nat(s, radix) == x);
+				assert(Nat(x.to_string(radix), radix) == x);
+				for (char &c : s) {
+					if (c >= 'a') c = char(c - 'a' + 'A');
+				}
+				assert(Nat(s, radix) == x);
+			}
+			assert(Nat(0).to_string(radix) == prefix + "0");
+			assert(Nat(Nat::limb_t(radix - 1)).to_string(radix) == prefix + digits36[radix - 1]);
+		}
+	}
+	Nat::from_string_threshold = from_string_threshold;
+	assert(Nat("0b12", 16) == 0xb12);
+	assert(Nat("0x1z", 36) == 42839);
+	assert(Nat("0x1f", 8) == 0x1f);
+
+	/* digit alphabets */
+	std::string base58 = "123456789ABCDEFGHJKLMNPQRSTUVWXYZabcdefghijkmnopqrstuvwxyz";
+	std::string base64 = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+	Nat hello = nat32({0x726c6421, 0x6f20576f, 0x48656c6c}), b23;
+	assert(hello.to_string(base58) == "2NEpo7TZRRrLZSi2U");
+	b23.from_string("2NEpo7TZRRrLZSi2U", 17, base58);
+	assert(b23 == hello);
+	assert(Nat(0).to_string(base58) == "1");
+	for (size_t n : { 1, 5, 100 }) {
+		Nat x = rand_nat(n);
+		for (const std::string &alphabet : { base58, base64 }) {
+			std::string s = x.to_string(alphabet);
+			assert(s == to_radix_ref(x, alphabet.size(), alphabet));
+			b23.from_string(s.c_str(), s.size(), alphabet);
+			assert(b23 == x);
+		}
+	}
+
+	/* invalid radixes, alphabets and digits */
+	auto rejects = [](std::function<void()> f) {
+		try {
+			f();
+		} catch (const std::invalid_argument &) {
+			return true;
+		}
+		return false;
+	};
+	assert(rejects([]() { Nat(5).to_string(37); }));
+	assert(rejects([]() { Nat(5).to_string(1); }));
+	assert(rejects([]() { Nat("12", 37); }));
+	assert(rejects([]() { Nat("12a"); }));
+	assert(rejects([]() { Nat("129", 8); }));
+	assert(rejects([]() { Nat("0x1g"); }));
+	assert(rejects([]() { Nat("0b102"); }));
+	assert(rejects([]() { Nat(5).to_string(std::string("0")); }));
+	assert(rejects([]() { Nat(5).to_string(std::string("aba")); }));
+	assert(rejects([&]() { b23.from_string("0OI", 3, base58); }));
+
+	/* zero chunks, powers of the radix and fixed width values */
+	assert(Nat(10).pow(40).to_string() == "1" + std::string(40, '0'));
+	assert((Nat(7) * Nat(10).pow(36)).to_string() == "7" + std::string(36, '0'));
+	assert((Nat(10).pow(300) + 1).to_string() == "1" + std::string(299, '0') + "1");
+	assert(Nat(5, Nat::_unsigned, 64).to_string(16) == "0x5");
+	assert(Nat(5, Nat::_unsigned, 128).to_string(8) == "5");
+	for (size_t radix : { 3, 10, 36 }) {
+		for (size_t k = 1; k < 200; k += 7) {
+			Nat p = Nat(Nat::limb_t(radix)).pow(k);
+			assert(p.formatted_size(radix) == k + 1);
+			assert((p - 1).formatted_size(radix) == k);
+			assert(p.to_string(radix) == "1" + std::string(k, '0'));
+		}
+	}
+
+	/* large powers of the radix are sized from the cached powers */
+	Nat::power_cache_clear();
+	Nat::power_cache_reserve(10, 20001);
+	size_t b24n = Nat::power_cache_size();
+	for (size_t k : { 1000, 4099, 12345, 20000 }) {
+		assert(Nat(10).pow(k).formatted_size(10) == k + 1);
+	}
+	assert(Nat::power_cache_size() == b24n);
+	for (size_t radix : { 3, 10, 36 }) {
+		for (size_t k : { 1000, 4099, 12345, 19999 }) {
+			Nat p = Nat(Nat::limb_t(radix)).pow(k);
+			assert(p.formatted_size(radix) == k + 1);
+			assert((p - 1).formatted_size(radix) == k);
+			assert((p + 1).formatted_size(radix) == k + 1);
+			assert((p * Nat(3)).formatted_size(radix) == (radix > 3 ? k + 1 : k + 2));
+			assert(((p >> 1) + p).formatted_size(radix) == k + 1);
+		}
+	}
+
+	/* to_chars and formatted_size */
+	for (size_t radix = 2; radix <= 36; radix++) {
+		for (size_t n : { 1, 2, 50 }) {
+			Nat x = rand_nat(n);
+			std::string s = to_radix_ref(x, radix, digits36);
+			assert(x.formatted_size(radix) == s.size());
+			std::vector<char> buf(s.size() + 1, '#');
+			Nat::to_chars_result res = x.to_chars(buf.data(), buf.data() + s.size(), radix);
+			assert(res.ec == std::errc() && res.ptr == buf.data() + s.size());
+			assert(std::string(buf.data(), s.size()) == s && buf[s.size()] == '#');
+			res = x.to_chars(buf.data(), buf.data() + s.size() - 1, radix);
+			assert(res.ec == std::errc::value_too_large && res.ptr == buf.data() + s.size() - 1);
+		}
+	}
+	char b24[4];
+	assert(Nat(0).to_chars(b24, b24 + 1).ptr == b24 + 1 && b24[0] == '0');
+	assert(Nat(0).formatted_size(16) == 1);
+
+	/* stream output in blocks */
+	for (size_t n : { 1, 3, 700, 3000 }) {
+		Nat x = rand_nat(n);
+		std::ostringstream dec, hex, oct;
+		dec << x;
+		hex << std::hex << x;
+		oct << std::oct << x;
+		assert(dec.str() == x.to_string(10));
+		assert("0x" + hex.str() == x.to_string(16));
+		assert(oct.str() == x.to_string(8));
+	}
+	std::ostringstream b24s;
+	b24s << std::showbase << std::hex << std::uppercase << Nat(0xabc) << ' '
+		<< std::nouppercase << std::oct << Nat(8) << ' ' << Nat(0) << ' ' << std::dec
+		<< std::setw(6) << std::setfill('*') << Nat(42) << ' '
+		<< std::left << std::setw(4) << Nat(7) << ' '
+		<< std::internal << std::hex << std::setw(7) << Nat(255);
+	assert(b24s.str() == "0XABC 010 0 ****42 7*** 0x***ff");
+
+	/* hex and binary kernels at each SIMD level */
+	int simd_level = Nat::simd_level;
+	for (int level : { 0, 1, 2 }) {
+		Nat::simd_level = level;
+		for (size_t n : { 1, 3, 4, 5, 12, 17, 64, 131 }) {
+			Nat x = rand_nat(n);
+			for (size_t radix : { 2, 16 }) {
+				std::string s = to_radix_ref(x, radix, digits36);
+				std::string prefix = radix == 2 ? "0b" : "0x";
+				assert(x.to_string(radix) == prefix + s);
+				assert(Nat(s, radix) == x);
+				assert(Nat(std::string(67, '0') + s, radix) == x);
+				for (char &c : s) {
+					if (c >= 'a') c = char(c - 'a' + 'A');
+				}
+				assert(Nat(s, radix) == x);
+				for (size_t i : { size_t(0), s.size() / 2, s.size() - 1 }) {
+					std::string t = s;
+					t[i] = radix == 2 ? '2' : 'g';
+					assert(rejects([&]() { Nat(t, radix); }));
+					t[i] = char(0xb1);
+					assert(rejects([&]() { Nat(t, radix); }));
+				}
+			}
+		}
+	}
+	Nat::simd_level = simd_level;
 
 	/* fixed width tests */
 	assert(Nat(0xffffffff, Nat::_unsigned, 32) + 2 == 1);
 	assert(Nat(0xffffffff, Nat::_unsigned, 31) == 0x7fffffff);
 	assert(Nat(0x7fffffff, Nat::_unsigned, 31) + 2 == 1);
 	assert(Nat("0xffffffff", Nat::_unsigned, 31) == 0x7fffffff);
-	assert(Nat(100000) * Nat(100000) == (Nat{0x540be400, 0x2}));
-	assert(Nat(100000, Nat::_unsigned, 34) * Nat(100000, Nat::_unsigned, 34) == (Nat{0x540be400, 0x2}));
+	assert(Nat(100000) * Nat(100000) == (nat32({0x540be400, 0x2})));
+	assert(Nat(100000, Nat::_unsigned, 34) * Nat(100000, Nat::_unsigned, 34) == (nat32({0x540be400, 0x2})));
 	assert(Nat(100000, Nat::_unsigned, 33) * Nat(100000, Nat::_unsigned, 33) == Nat(0x540be400));
 	assert(Nat(100000, Nat::_unsigned, 32) * Nat(100000, Nat::_unsigned, 32) == Nat(0x540be400));
 	assert(Nat(100000, Nat::_unsigned, 20) * Nat(100000, Nat::_unsigned, 20) == Nat(0xbe400));
 	assert(-Nat(1, Nat::_unsigned, 32) == Nat(-1, Nat::_unsigned, 32));
-	assert(-Nat(1, Nat::_unsigned, 64) == Nat({0xffffffff, 0xffffffff}, Nat::_unsigned, 64));
-	assert(-Nat(1, Nat::_unsigned, 65) == Nat({0xffffffff, 0xffffffff,1}, Nat::_unsigned, 65));
-	assert(Nat({0xffffffff, 0x7fffffff,1}, Nat::_unsigned, 65) >> 1 == Nat({0xffffffff, 0xbfffffff}, Nat::_unsigned, 65));
-	assert(-Nat(1, Nat::_signed, 65) >> 1 == Nat({0xffffffff, 0xffffffff,1}, Nat::_signed, 65));
-	assert(Nat({0xffffffff, 0x7fffffff,1}, Nat::_signed, 65) >> 1 == Nat({0xffffffff, 0xbfffffff,1}, Nat::_signed, 65));
-	assert(Nat({0xffffffff, 0xffffffff}, Nat::_signed, 65) >> 1 == Nat({0xffffffff, 0x7fffffff}, Nat::_signed, 65));
-	assert(-Nat(1, Nat::_unsigned, 65) >> 1 == Nat({0xffffffff, 0xffffffff}, Nat::_unsigned, 65));
-	assert(-Nat(1, Nat::_unsigned, 65) >> 2 == Nat({0xffffffff, 0x7fffffff}, Nat::_unsigned, 65));
-	assert(-Nat(1, Nat::_unsigned, 65) << 1 == Nat({0xfffffffe, 0xffffffff,1}, Nat::_unsigned, 65));
-	assert(-Nat(1, Nat::_unsigned, 65) << 2 == Nat({0xfffffffc, 0xffffffff,1}, Nat::_unsigned, 65));
+	assert(-Nat(1, Nat::_unsigned, 64) == nat32({0xffffffff, 0xffffffff}, Nat::_unsigned, 64));
+	assert(-Nat(1, Nat::_unsigned, 65) == nat32({0xffffffff, 0xffffffff,1}, Nat::_unsigned, 65));
+	assert(nat32({0xffffffff, 0x7fffffff,1}, Nat::_unsigned, 65) >> 1 == nat32({0xffffffff, 0xbfffffff}, Nat::_unsigned, 65));
+	assert(-Nat(1, Nat::_signed, 65) >> 1 == nat32({0xffffffff, 0xffffffff,1}, Nat::_signed, 65));
+	assert(nat32({0xffffffff, 0x7fffffff,1}, Nat::_signed, 65) >> 1 == nat32({0xffffffff, 0xbfffffff,1}, Nat::_signed, 65));
+	assert(nat32({0xffffffff, 0xffffffff}, Nat::_signed, 65) >> 1 == nat32({0xffffffff, 0x7fffffff}, Nat::_signed, 65));
+	assert(-Nat(1, Nat::_unsigned, 65) >> 1 == nat32({0xffffffff, 0xffffffff}, Nat::_unsigned, 65));
+	assert(-Nat(1, Nat::_unsigned, 65) >> 2 == nat32({0xffffffff, 0x7fffffff}, Nat::_unsigned, 65));
+	assert(-Nat(1, Nat::_unsigned, 65) << 1 == nat32({0xfffffffe, 0xffffffff,1}, Nat::_unsigned, 65));
+	assert(-Nat(1, Nat::_unsigned, 65) << 2 == nat32({0xfffffffc, 0xffffffff,1}, Nat::_unsigned, 65));
+	assert(Nat(0x80000000, Nat::_signed, 32) >> 4 == Nat(0xf8000000, Nat::_signed, 32));
+	assert(-Nat(256, Nat::_signed, 100) >> 4 == -Nat(16, Nat::_signed, 100));
+	assert(-Nat(256, Nat::_signed, 100) >> 99 == -Nat(1, Nat::_signed, 100));
 
 	/* unsigned comparison */
 	assert(Nat(-1, Nat::_unsigned, 32) > Nat(1, Nat::_unsigned, 32));
@@ -263,6 +779,8 @@ int main(int argc, char const *argv[])
 	assert(Nat(0, Nat::_signed, 32) < Nat(1, Nat::_signed, 32));
 	assert(Nat(1, Nat::_signed, 32) > Nat(0, Nat::_signed, 32));
 	assert(Nat(1, Nat::_signed, 32) > Nat(-1, Nat::_signed, 32));
+	assert(Nat(-2, Nat::_signed, 32) < Nat(-1, Nat::_signed, 32));
+	assert(!(Nat(-1, Nat::_signed, 32) < Nat(-2, Nat::_signed, 32)));
 
 	assert(Nat(0).num_bits() == 0);
 	assert(Nat(1).num_bits() == 1);